@@ -8,40 +8,187 @@
 #ifndef TDZDD_HPP_
 #define TDZDD_HPP_
 
+#include "TdZddCheckpoint.hpp"
+#include "TdZddConcurrentHash.hpp"
+#include "TdZddEvalTuple.hpp"
+#include "TdZddFile.hpp"
 #include "TdZddHash.hpp"
+#include "TdZddMemory.hpp"
 #include "TdZddNode.hpp"
 #include "TdZddPool.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <new>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
 #include <vector>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__unix__)
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
 /**
  * トップダウン手法によるZDD構築.
  */
 class TdZdd {
+    template<typename Id> friend class TdZddFrozenBase;
+    friend class TdZddIndex;
+
+    /**
+     * 評価値の格納領域. evaluate() の呼び出し間で再利用する.
+     * 複製しても内容は引き継がない.
+     */
+    class EvalBuffer {
+        void* mem;
+        size_t bytes;
+
+    public:
+        EvalBuffer()
+                : mem(0), bytes(0) {
+        }
+
+        EvalBuffer(EvalBuffer const& o)
+                : mem(0), bytes(0) {
+        }
+
+        EvalBuffer& operator=(EvalBuffer const& o) {
+            return *this;
+        }
+
+        virtual ~EvalBuffer() {
+            ::operator delete(mem);
+        }
+
+        /**
+         * 少なくとも n 個の T を置ける未初期化領域を返す.
+         */
+        template<typename T>
+        T* get(size_t n) {
+            if (n * sizeof(T) > bytes) {
+                ::operator delete(mem);
+                mem = 0;
+                bytes = 0;
+                mem = ::operator new(n * sizeof(T));
+                bytes = n * sizeof(T);
+            }
+            return static_cast<T*>(mem);
+        }
+    };
+
+    /**
+     * subset() 中に状態を退避するファイルの置き場所.
+     * 指定したディレクトリの下に専用の一時ディレクトリを作り,
+     * レベル毎のファイルに追記する. 消滅時に全て削除する.
+     */
+    class SpillArea {
+        std::string path;
+        std::vector<char> used;
+
+        SpillArea(SpillArea const&);
+        SpillArea& operator=(SpillArea const&);
+
+    public:
+        SpillArea(std::string const& dir, int n)
+                : used(n) {
+#if defined(__unix__)
+            std::string tmpl = dir + "/tdzdd.XXXXXX";
+            if (::mkdtemp(&tmpl[0]) == 0) {
+                throw std::runtime_error(dir + ": Cannot create spill directory");
+            }
+            path = tmpl;
+#else
+            throw std::runtime_error("TdZdd: Spilling is not supported");
+#endif
+        }
+
+        virtual ~SpillArea() {
+            for (size_t k = 0; k < used.size(); ++k) {
+                if (used[k]) std::remove(file(k).c_str());
+            }
+#if defined(__unix__)
+            ::rmdir(path.c_str());
+#endif
+        }
+
+        std::string file(int k) const {
+            return path + "/" + std::to_string(k);
+        }
+
+        bool exists(int k) const {
+            return used[k];
+        }
+
+        void setExists(int k, bool flag) {
+            used[k] = flag;
+        }
+    };
+
     int numVars;                        ///< 変数の数.
     std::vector<TdZddNodeList> table;   ///< ノードテーブル本体.
     std::vector<TdZddPool> nodePool;
-    std::vector<TdZddPool> newNodePool;
-    std::vector<TdZddPool> workDataPool;
+    std::vector<std::vector<TdZddPool>> newNodePool;  ///< スレッド毎のプール.
+    std::vector<std::vector<TdZddPool>> workDataPool; ///< スレッド毎のプール.
+    std::vector<TdZddPool> nodeListPool; ///< 旧ノードの nodeList のプール.
+    std::vector<std::vector<TdZddNode*>> touchedNodes; ///< スレッド毎に新ノードを追加した旧ノード.
     TdZddNode const0;                   ///< 0終端ノード.
     TdZddNode const1;                   ///< 1終端ノード.
     TdZddNode* top;                     ///< 始点へのポインタ.
+    bool useMP;                         ///< マルチスレッド処理を行うか.
+    size_t evalSize;                    ///< 番号付けしたノードの数.
+    std::vector<TdZddNode*> evalNodes;  ///< 並列評価中のレベルのノード.
+    EvalBuffer evalBuffer;              ///< 評価値の格納領域.
+    void const* evalValues;             ///< evalAndSubset() 中の評価値.
+    std::string checkpointPath;         ///< チェックポイントの保存先.
+    int checkpointLevels;               ///< チェックポイントのレベル間隔.
+    double checkpointSeconds;           ///< チェックポイントの時間間隔.
+    int checkpointLevelCount;           ///< 前回の保存からのレベル数.
+    std::chrono::steady_clock::time_point checkpointTime; ///< 前回の保存時刻.
+    uint64_t operationCount;            ///< 状態を変える操作の実行回数.
+    std::unique_ptr<std::ifstream> resumeStream; ///< 再開中のチェックポイント.
+    TdZddCheckpointHeader resumeHeader; ///< 再開中のチェックポイントのヘッダ.
+    std::string resumeType;             ///< 再開中のチェックポイントの状態の型名.
+    size_t memoryBudget;                ///< プールの使用量の上限. 0 なら制限なし.
+    std::function<bool(TdZddMemoryUsage const&)> memoryHandler; ///< 上限を超えそうな時に呼ぶ関数.
+    std::string spillDirectory;         ///< 状態の退避先. 空なら退避しない.
+    std::unique_ptr<SpillArea> spill;   ///< subset() 中の退避ファイル.
+    std::vector<std::vector<TdZddNode*>> spillNodes; ///< スレッド毎の退避する未処理ノード.
+    void const* spillState;             ///< 退避した状態を読み込む複製の元.
 
 public:
     TdZdd()
-            : numVars(0), table(numVars), nodePool(numVars),
-              newNodePool(numVars), workDataPool(numVars),
-              const0(numVars, 0, &const1), const1(numVars, &const0, 0),
-              top(&const0) {
+            : numVars(0), table(numVars), nodePool(numVars), newNodePool(),
+              workDataPool(), const0(numVars, 0, &const1),
+              const1(numVars, &const0, 0), top(&const0), useMP(false),
+              evalSize(0), evalValues(0), checkpointLevels(0),
+              checkpointSeconds(0), checkpointLevelCount(0),
+              operationCount(0), memoryBudget(0), spillState(0) {
     }
 
     TdZdd(int n)
-            : numVars(n), table(numVars), nodePool(numVars),
-              newNodePool(numVars), workDataPool(numVars),
-              const0(numVars, 0, &const1), const1(numVars, &const0, 0),
-              top(&const1) {
+            : numVars(n), table(numVars), nodePool(numVars), newNodePool(),
+              workDataPool(), const0(numVars, 0, &const1),
+              const1(numVars, &const0, 0), top(&const1), useMP(false),
+              evalSize(0), evalValues(0), checkpointLevels(0),
+              checkpointSeconds(0), checkpointLevelCount(0),
+              operationCount(0), memoryBudget(0), spillState(0) {
         for (int i = numVars - 1; i >= 0; --i) {
             top = new (nodePool[i].allocate<TdZddNode>()) TdZddNode(i, top,
                     top);
@@ -49,7 +196,10 @@ public:
         }
     }
 
-    TdZdd(TdZdd const& o) {
+    TdZdd(TdZdd const& o)
+            : useMP(o.useMP), evalSize(0), evalValues(0), checkpointLevels(0),
+              checkpointSeconds(0), checkpointLevelCount(0),
+              operationCount(0), memoryBudget(0), spillState(0) {
         operator=(o);
     }
 
@@ -87,8 +237,8 @@ public:
         };
 
         initialize(o.numVars);
-        subset(Subsetter(o));
-        reduce();
+        doSubset<Subsetter,void>(Subsetter(o));
+        doReduce();
         return *this;
     }
 
@@ -99,9 +249,7 @@ public:
         nodePool.clear();
         nodePool.resize(n);
         newNodePool.clear();
-        newNodePool.resize(n);
         workDataPool.clear();
-        workDataPool.resize(n);
         const0 = TdZddNode(n, 0, &const1);
         const1 = TdZddNode(n, &const0, 0);
         top = &const1;
@@ -116,156 +264,307 @@ public:
         return numVars;
     }
 
+    /**
+     * マルチスレッド処理の有無を設定する.
+     * OpenMPなしでコンパイルされた場合は常にシングルスレッドで動作する.
+     * @param flag 使用する場合true.
+     */
+    void useMultiProcessors(bool flag = true) {
+        useMP = flag;
+    }
+
+    /**
+     * 並列処理に用いるスレッド数.
+     */
+    int threads() const {
+#ifdef _OPENMP
+        if (useMP) return omp_get_max_threads();
+#endif
+        return 1;
+    }
+
     TdZddNode const* getTop() const {
         return top;
     }
 
-private:
-    template<typename Eval, typename T>
-    T doEval(Eval& eval) {
-        const0.tmp<T>() = eval.value0();
-        const1.tmp<T>() = eval.value1();
+    /**
+     * subset() と evalAndSubset() の途中経過をレベルの区切りで保存する.
+     * levels レベル毎, または前回の保存から seconds 秒毎に path を上書きする.
+     * 状態が save() と load() を持たないフィルタの実行中は保存しない.
+     * @param path 保存先. 空文字列なら保存しない.
+     * @param levels レベル間隔. 0以下なら使わない.
+     * @param seconds 時間間隔. 0以下なら使わない.
+     */
+    void setCheckpoint(std::string const& path, int levels = 0,
+            double seconds = 0) {
+        checkpointPath = path;
+        checkpointLevels = levels;
+        checkpointSeconds = seconds;
+    }
 
-        for (int i = numVars - 1; i >= 0; --i) {
-            for (TdZddNode* f = table[i].front(); f != 0; f = f->next) {
-                f->tmp<T>() = eval.value(f->child0->varIndex,
-                        f->child0->tmp<T>(), f->child1->varIndex,
-                        f->child1->tmp<T>(), f->varIndex);
+    /**
+     * subset() と evalAndSubset() で使うプールの大きさの上限を設定する.
+     * レベルの区切り毎に, 直前のレベルでの増加分が次のレベルでも続くとして
+     * 使用量を予測し, 上限を超えるなら handler を呼ぶ.
+     * プール間で共有する空きブロックのキャッシュは使用量に数えず,
+     * 予測値との和が上限に収まるよう区切り毎に減らす.
+     * キャッシュの上限も bytes 以下にする.
+     * handler が無いか偽を返した場合は, チェックポイントを設定していれば
+     * そのレベルから再開できるよう保存し, 図を空にして領域を返してから
+     * std::runtime_error を投げる.
+     * @param bytes 上限のバイト数. 0 なら制限しない.
+     * @param handler 使用量を受け取り, 処理を続けるなら真を返す関数.
+     */
+    void setMemoryBudget(size_t bytes,
+            std::function<bool(TdZddMemoryUsage const&)> handler = nullptr) {
+        memoryBudget = bytes;
+        memoryHandler = handler;
+        if (bytes > 0) {
+            TdZddPool::setCacheLimit(std::min(TdZddPool::cacheLimit(), bytes));
+        }
+    }
+
+    /**
+     * subset() と evalAndSubset() で, 次のレベルより先のレベルの
+     * 未処理ノードの状態を dir の下のファイルに退避する.
+     * 状態はレベルの区切り毎にレベル別のファイルへ追記し,
+     * そのレベルの処理を始める時に読み戻す.
+     * 重複の除去は読み戻した後にメモリ上で行い, 新ノード自体は退避しない.
+     * チェックポイントの書き出しと再開では, 退避した状態をメモリに読み戻さず
+     * 退避ファイルとの間で1つずつ写す.
+     * 状態が save() と load() を持たないフィルタの実行中は退避しない.
+     * @param dir 退避先のディレクトリ. 空文字列なら退避しない.
+     */
+    void setSpillDirectory(std::string const& dir) {
+        spillDirectory = dir;
+    }
+
+    /**
+     * 現在のプールの使用量をレベルと種類毎に返す.
+     */
+    TdZddMemoryUsage memoryUsage() const {
+        TdZddMemoryUsage u;
+        u.levels.resize(numVars);
+        for (int i = 0; i < numVars; ++i) {
+            TdZddMemoryUsage::Level& l = u.levels[i];
+            l.node = nodePool[i].usage();
+            for (size_t t = 0; t < newNodePool.size(); ++t) {
+                l.newNode += newNodePool[t][i].usage();
+            }
+            for (size_t t = 0; t < workDataPool.size(); ++t) {
+                l.workData += workDataPool[t][i].usage();
             }
+            if (size_t(i) < nodeListPool.size()) {
+                l.workData += nodeListPool[i].usage();
+            }
+        }
+        u.cached = TdZddPool::cachedBytes();
+        u.budget = memoryBudget;
+        return u;
+    }
+
+    /**
+     * チェックポイントから再開する.
+     * 以後 subset(), evalAndSubset(), reduce() を保存時と同じ順序と引数で
+     * 呼び出すと, 保存時点より前の操作は何もせずに戻り,
+     * 保存時点の操作は保存したレベルから処理を続ける.
+     * @param path setCheckpoint() で指定した保存先.
+     */
+    void resume(std::string const& path) {
+        std::unique_ptr<std::ifstream> is(
+                new std::ifstream(path.c_str(), std::ios::binary));
+        if (!*is) throw std::runtime_error(path + ": Cannot open");
+
+        is->read(reinterpret_cast<char*>(&resumeHeader), sizeof(resumeHeader));
+        if (!*is || !resumeHeader.valid()) {
+            throw std::runtime_error(path + ": Not a checkpoint file");
+        }
+        if (resumeHeader.numVars != uint64_t(numVars)) {
+            throw std::runtime_error(path + ": Variable count mismatch");
+        }
+        if (resumeHeader.operation <= operationCount) {
+            throw std::runtime_error(path + ": Operation already done");
         }
 
-        return top->tmp<T>();
+        resumeType.resize(resumeHeader.typeBytes);
+        is->read(&resumeType[0], resumeType.size());
+        if (!*is) throw std::runtime_error(path + ": Unexpected end of file");
+
+        resumeStream = std::move(is);
     }
 
-    template<typename Eval, typename T>
-    T doEval(Eval const& eval) {
-        const0.tmp<T>() = eval.value0();
-        const1.tmp<T>() = eval.value1();
+private:
+    /**
+     * 全ノードにボトムアップの通し番号を tmpId として付ける.
+     * 0と1は終端ノードで, 各レベルのノードには連続した番号が付く.
+     */
+    void numberNodes() {
+        const0.tmpId = 0;
+        const1.tmpId = 1;
+        size_t id = 2;
 
         for (int i = numVars - 1; i >= 0; --i) {
             for (TdZddNode* f = table[i].front(); f != 0; f = f->next) {
-                f->tmp<T>() = eval.value(f->child0->varIndex,
-                        f->child0->tmp<T>(), f->child1->varIndex,
-                        f->child1->tmp<T>(), f->varIndex);
+                f->tmpId = id++;
             }
         }
 
-        return top->tmp<T>();
+        evalSize = id;
     }
 
     template<typename Eval, typename T>
-    class EvalRunner {
-        T* work;
+    static void evalNode(Eval& eval, T* values, TdZddNode const* f) {
+        TdZddNode const* f0 = f->child0;
+        TdZddNode const* f1 = f->child1;
+        new (values + f->tmpId) T(eval.value(f0->varIndex, values[f0->tmpId],
+                f1->varIndex, values[f1->tmpId], f->varIndex));
+    }
 
-    public:
-        EvalRunner()
-                : work(0) {
-        }
+    template<typename Eval, typename T>
+    T* doEvalSerial(Eval& eval) {
+        numberNodes();
+        T* values = evalBuffer.get<T>(evalSize);
+        new (values + 0) T(eval.value0());
+        new (values + 1) T(eval.value1());
 
-        virtual ~EvalRunner() {
-            delete[] work;
+        for (int i = numVars - 1; i >= 0; --i) {
+            for (TdZddNode* f = table[i].front(); f != 0; f = f->next) {
+                evalNode<Eval,T>(eval, values, f);
+            }
         }
 
-        T operator()(TdZdd& dd, Eval& eval) {
-            size_t const size = 2 + dd.size();
-            work = new T[size];
-            T* p = work;
+        return values;
+    }
 
-            dd.const0.tmpPtr = p++;
-            dd.const1.tmpPtr = p++;
+    /**
+     * const な評価器は状態を持たないので, レベル内のノードを並列に評価する.
+     */
+    template<typename Eval, typename T>
+    T* doEval(Eval const& eval) {
+        if (threads() == 1) return doEvalSerial<Eval const,T>(eval);
 
-            for (int i = dd.numVars - 1; i >= 0; --i) {
-                for (TdZddNode* f = dd.table[i].front(); f != 0; f = f->next) {
-                    f->tmpPtr = p++;
-                }
+        numberNodes();
+        T* values = evalBuffer.get<T>(evalSize);
+        new (values + 0) T(eval.value0());
+        new (values + 1) T(eval.value1());
+
+        for (int i = numVars - 1; i >= 0; --i) {
+            evalNodes.clear();
+            for (TdZddNode* f = table[i].front(); f != 0; f = f->next) {
+                evalNodes.push_back(f);
             }
+            long const n = evalNodes.size();
 
-            return dd.doEval<Eval,T>(eval);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+            for (long j = 0; j < n; ++j) {
+                evalNode<Eval const,T>(eval, values, evalNodes[j]);
+            }
         }
 
-        T operator()(TdZdd& dd, Eval const& eval) {
-            size_t const size = 2 + dd.size();
-            work = new T[size];
-            T* p = work;
+        return values;
+    }
 
-            dd.const0.tmpPtr = p++;
-            dd.const1.tmpPtr = p++;
+    /**
+     * evalBuffer 上に構築した評価値を所有し, 破棄時に解体する.
+     */
+    template<typename T>
+    class EvalValues {
+        TdZdd const& dd;
+        T* values;
 
-            for (int i = dd.numVars - 1; i >= 0; --i) {
-                for (TdZddNode* f = dd.table[i].front(); f != 0; f = f->next) {
-                    f->tmpPtr = p++;
-                }
-            }
+        EvalValues(EvalValues const&);
+        EvalValues& operator=(EvalValues const&);
 
-            return dd.doEval<Eval,T>(eval);
+    public:
+        EvalValues(TdZdd const& dd, T* values)
+                : dd(dd), values(values) {
         }
-    };
 
-    template<typename Eval>
-    struct EvalRunner<Eval,bool> {
-        int operator()(TdZdd& dd, Eval& eval) {
-            return dd.doEval<Eval,bool>(eval);
-        }
-        int operator()(TdZdd& dd, Eval const& eval) {
-            return dd.doEval<Eval,bool>(eval);
+        virtual ~EvalValues() {
+            if (std::is_trivially_destructible<T>::value) return;
+            for (size_t j = 0; j < dd.evalSize; ++j) {
+                values[j].~T();
+            }
         }
-    };
 
-    template<typename Eval>
-    struct EvalRunner<Eval,int> {
-        int operator()(TdZdd& dd, Eval& eval) {
-            return dd.doEval<Eval,int>(eval);
-        }
-        int operator()(TdZdd& dd, Eval const& eval) {
-            return dd.doEval<Eval,int>(eval);
+        T const* get() const {
+            return values;
         }
-    };
 
-    template<typename Eval>
-    struct EvalRunner<Eval,double> {
-        double operator()(TdZdd& dd, Eval& eval) {
-            return dd.doEval<Eval,double>(eval);
-        }
-        double operator()(TdZdd& dd, Eval const& eval) {
-            return dd.doEval<Eval,double>(eval);
+        T const& operator[](size_t id) const {
+            return values[id];
         }
     };
 
 public:
+    /**
+     * ボトムアップに評価する.
+     * const な評価器はマルチスレッド処理が有効ならレベル毎に並列に呼ばれるので,
+     * value() はスレッドセーフでなければならない.
+     * @param eval 評価器.
+     * @return 始点の評価値.
+     */
     template<typename Eval>
     typename Eval::ValueType evaluate(Eval& eval) {
-        return EvalRunner<Eval,typename Eval::ValueType>()(*this, eval);
+        typedef typename Eval::ValueType T;
+        EvalValues<T> values(*this, doEvalSerial<Eval,T>(eval));
+        return values[top->tmpId];
     }
 
     template<typename Eval>
     typename Eval::ValueType evaluate(Eval const& eval) {
-        return EvalRunner<Eval,typename Eval::ValueType>()(*this, eval);
+        typedef typename Eval::ValueType T;
+        EvalValues<T> values(*this, doEval<Eval,T>(eval));
+        return values[top->tmpId];
+    }
+
+    /**
+     * 複数の評価器を1回の走査でまとめて評価する.
+     * @return 始点の評価値の組.
+     */
+    template<typename Eval1, typename Eval2, typename ... Evals>
+    std::tuple<typename Eval1::ValueType,typename Eval2::ValueType,
+            typename Evals::ValueType...> evaluate(Eval1 const& eval1,
+            Eval2 const& eval2, Evals const&... evals) {
+        return evaluate(TdZddEvalTuple<Eval1,Eval2,Evals...>(eval1, eval2,
+                evals...));
     }
 
 private:
     template<typename Subsetter>
     Subsetter* makeCopy(Subsetter const& state, TdZddPool& pool) {
-        return new (pool.allocate<Subsetter>()) Subsetter(state, pool);
+        return TdZddStateCopy<Subsetter>::copy(state, pool);
     }
 
     template<typename Subsetter, typename T>
     struct DownCaller {
-        int operator()(Subsetter* s, bool take, int fromIndex, TdZddNode* f) {
-            return s->down(take, fromIndex, f->varIndex, f->tmp<T>());
+        int operator()(Subsetter* s, bool take, int fromIndex, TdZddNode* f,
+                void const* values) {
+            return s->down(take, fromIndex, f->varIndex,
+                    static_cast<T const*>(values)[f->tmpId]);
         }
     };
 
     template<typename Subsetter>
     struct DownCaller<Subsetter,void> {
-        int operator()(Subsetter* s, bool take, int fromIndex, TdZddNode* f) {
+        int operator()(Subsetter* s, bool take, int fromIndex, TdZddNode* f,
+                void const* values) {
             return s->down(take, fromIndex, f->varIndex);
         }
     };
 
+    /**
+     * 枝をたどって行き先の新ノードを作る.
+     * 状態 s は行き先のレベルのプールになければそこへ複製する.
+     * @param poolIndex s を置いたプールのレベル. 負ならプールの外にある.
+     */
     template<typename Subsetter, typename T>
     void doSubsetEdge(Subsetter* s, int poolIndex, bool take, int fromIndex,
-            TdZddNode* oldToNode, TdZddNode** newToNodePointer) {
-        int toIndex = DownCaller<Subsetter,T>()(s, take, fromIndex, oldToNode);
+            TdZddNode* oldToNode, TdZddNode** newToNodePointer, int tid) {
+        int toIndex = DownCaller<Subsetter,T>()(s, take, fromIndex, oldToNode,
+                evalValues);
         if (toIndex == 0) {
             oldToNode = &const0;
         }
@@ -281,23 +580,27 @@ private:
         int k = oldToNode->varIndex;
         if (k < numVars) {
             if (poolIndex < k) {
-                Subsetter* t = makeCopy(*s, workDataPool[k]);
-                s->~Subsetter();
+                Subsetter* t = makeCopy(*s, workDataPool[tid][k]);
+                TdZddStateCopy<Subsetter>::destroy(s);
                 s = t;
             }
-            void* mem = newNodePool[k].allocate<TdZddNode>();
+            void* mem = newNodePool[tid][k].allocate<TdZddNode>();
             TdZddNode* newToNode = new (mem) TdZddNode(k, s, newToNodePointer);
-            oldToNode->nodeList->push_back(newToNode);
+            TdZddNodeList& nl = oldToNode->nodeList[tid];
+            if (tid != 0 && nl.empty()) touchedNodes[tid].push_back(oldToNode);
+            nl.push_back(newToNode);
+            if (spill && k > fromIndex + 1) spillNodes[tid].push_back(newToNode);
+            *newToNodePointer = 0; // 未処理の目印
         }
         else { // terminal node
-            s->~Subsetter();
+            TdZddStateCopy<Subsetter>::destroy(s);
             *newToNodePointer = oldToNode;
         }
     }
 
     template<typename Subsetter, typename T>
     void doSubsetNode(Subsetter* s, TdZddNode const* oldNode,
-            TdZddNode* newNode) {
+            TdZddNode* newNode, int tid) {
         int const i = oldNode->varIndex;
         assert(i == newNode->varIndex);
         assert(i < numVars);
@@ -307,124 +610,887 @@ private:
 
             if (oldNode->child1 == &const0) {
                 newNode->child1 = &const0;
-                s->~Subsetter();
+                TdZddStateCopy<Subsetter>::destroy(s);
                 return;
             }
 
             doSubsetEdge<Subsetter,T>(s, i, true, i, oldNode->child1,
-                    &newNode->child1);
+                    &newNode->child1, tid);
         }
         else if (oldNode->child1 == &const0) {
             newNode->child1 = &const0;
             doSubsetEdge<Subsetter,T>(s, i, false, i, oldNode->child0,
-                    &newNode->child0);
+                    &newNode->child0, tid);
+        }
+        else if (TdZddStateCopy<Subsetter>::pod) {
+            // 1枝の状態はスタック上で試し, 生き残った場合だけ行き先のプールに複製する
+            typename std::aligned_storage<sizeof(Subsetter),
+                    alignof(Subsetter)>::type buf;
+            Subsetter* t = static_cast<Subsetter*>(std::memcpy(&buf, s,
+                    sizeof(Subsetter)));
+            doSubsetEdge<Subsetter,T>(s, i, false, i, oldNode->child0,
+                    &newNode->child0, tid);
+            doSubsetEdge<Subsetter,T>(t, -1, true, i, oldNode->child1,
+                    &newNode->child1, tid);
         }
         else {
             int j = oldNode->child1->varIndex;
             if (j >= numVars) j = i;
-            Subsetter* t = makeCopy(*s, workDataPool[j]);
+            Subsetter* t = makeCopy(*s, workDataPool[tid][j]);
             doSubsetEdge<Subsetter,T>(s, i, false, i, oldNode->child0,
-                    &newNode->child0);
+                    &newNode->child0, tid);
             doSubsetEdge<Subsetter,T>(t, j, true, i, oldNode->child1,
-                    &newNode->child1);
+                    &newNode->child1, tid);
+        }
+    }
+
+    /**
+     * ノードリストの重複を除去する.
+     * @param nl ノードリスト.
+     * @param uniq 作業用のハッシュ表.
+     */
+    template<typename Subsetter>
+    void doUniq(TdZddNodeList& nl,
+            TdZddHashMap<Subsetter const*,TdZddNode*>& uniq) {
+        size_t const m = nl.size();
+
+        if (m == 1) {
+            TdZddNode* newNode = nl.front();
+            *newNode->referrer = newNode;
+        }
+        else if (m != 0) {
+            uniq.initialize(m);
+
+            for (TdZddNodeList::iterator p = nl.begin(); p != nl.end();) {
+                TdZddNode* newNode = *p;
+                Subsetter* s = reinterpret_cast<Subsetter*>(newNode->state);
+
+                TdZddNode* uniqNewNode = uniq.put(s, newNode);
+                *newNode->referrer = uniqNewNode;
+
+                if (uniqNewNode == newNode) {
+                    ++p;
+                }
+                else {
+                    nl.erase(p);
+                    TdZddStateCopy<Subsetter>::destroy(s);
+                }
+            }
         }
     }
 
+    /**
+     * 構築済みのレベルから1終端に到達しないノードを除去する.
+     * 未処理の枝 (0) は到達するものとみなし, 除去したノードへの枝は0終端に付け替える.
+     * 除去したノードが多いレベルは残ったノードを新しいプールに詰め直して領域を返す.
+     * 詰め直したノードの未処理の枝の参照元は, 旧ノードの同じ枝に新しい場所を書いて
+     * 未処理ノードから付け替える.
+     * @param last 構築済みの最後のレベル.
+     * @param compact 詰め直しを行うか.
+     * @return 残ったノードの数.
+     */
+    size_t sweepDeadNodes(int last, bool compact = true) {
+        std::vector<TdZddPool> retired(last + 1);
+        bool moved = false;
+        size_t total = 0;
+
+        for (int i = last; i >= 0; --i) {
+            TdZddNodeList& list = table[i];
+            size_t const n = list.size();
+
+            for (TdZddNodeList::iterator p = list.begin(); p != list.end();) {
+                TdZddNode* f = *p;
+                for (int b = 0; b <= 1; ++b) {
+                    TdZddNode*& c = b ? f->child1 : f->child0;
+                    if (c != 0 && c->varIndex < numVars) {
+                        c = c->tmpNodePtr ? c->tmpNodePtr : &const0;
+                    }
+                }
+
+                if (f->child0 == &const0 && f->child1 == &const0) {
+                    f->tmpNodePtr = 0;
+                    list.erase(p);
+                }
+                else {
+                    f->tmpNodePtr = f;
+                    ++p;
+                }
+            }
+
+            size_t const m = list.size();
+            total += m;
+            if (!compact || (n - m) * 4 < n) continue;
+
+            TdZddNodeList newList;
+            for (TdZddNode* f = list.front(); f != 0; f = f->next) {
+                TdZddNode* g = new (newNodePool[0][i].allocate<TdZddNode>())
+                        TdZddNode(i, f->child0, f->child1);
+                newList.push_back(g);
+                f->tmpNodePtr = g;
+                if (g->child0 == 0) {
+                    f->child0 = reinterpret_cast<TdZddNode*>(&g->child0);
+                    moved = true;
+                }
+                if (g->child1 == 0) {
+                    f->child1 = reinterpret_cast<TdZddNode*>(&g->child1);
+                    moved = true;
+                }
+            }
+            list.clear();
+            list.splice(newList);
+            retired[i].splice(nodePool[i]);
+            nodePool[i].splice(newNodePool[0][i]);
+        }
+
+        if (top != 0 && top->varIndex < numVars) {
+            top = top->tmpNodePtr ? top->tmpNodePtr : &const0;
+        }
+
+        if (moved) {
+            for (int i = last + 1; i < numVars; ++i) {
+                for (TdZddNode* f = table[i].front(); f != 0; f = f->next) {
+                    for (TdZddNode* p = f->nodeList[0].front(); p != 0;
+                            p = p->next) {
+                        if (*p->referrer != 0) {
+                            p->referrer =
+                                    reinterpret_cast<TdZddNode**>(*p->referrer);
+                        }
+                    }
+                }
+            }
+        }
+
+        return total;
+    }
+
+    typedef std::vector<std::pair<TdZddNode*,TdZddNode*>> WorkList;
+
+    /**
+     * レベル全体の重複除去に用いるキー.
+     * 派生元の旧ノードと状態の組を比較する.
+     */
+    template<typename Subsetter>
+    class UniqKeys {
+        WorkList const& work;
+
+        Subsetter const* state(size_t i) const {
+            return reinterpret_cast<Subsetter const*>(work[i].second->state);
+        }
+
+    public:
+        UniqKeys(WorkList const& work)
+                : work(work) {
+        }
+
+        size_t hashCode(size_t i) const {
+            return state(i)->hashCode() * 31
+                    + reinterpret_cast<size_t>(work[i].first);
+        }
+
+        bool equals(size_t i, size_t j) const {
+            return work[i].first == work[j].first
+                    && state(i)->equals(*state(j));
+        }
+    };
+
+    /**
+     * 状態を変える操作の開始時に呼ぶ.
+     * @return チェックポイントより前の操作で, 何もせずに戻るべき場合true.
+     */
+    bool skipOperation() {
+        ++operationCount;
+        return resumeStream && operationCount < resumeHeader.operation;
+    }
+
+    /**
+     * 現在の操作をチェックポイントから再開するか.
+     */
+    bool resuming() const {
+        return resumeStream && operationCount == resumeHeader.operation;
+    }
+
+    template<typename T>
+    static void writeValue(std::ostream& os, T const& value) {
+        os.write(reinterpret_cast<char const*>(&value), sizeof(value));
+    }
+
+    template<typename T>
+    T readValue() {
+        T value;
+        resumeStream->read(reinterpret_cast<char*>(&value), sizeof(value));
+        if (!*resumeStream) {
+            throw std::runtime_error("TdZdd: Unexpected end of checkpoint");
+        }
+        return value;
+    }
+
+    /**
+     * チェックポイントの旧ノードを読み込み, ノードテーブルを置き換える.
+     * 評価値を計算し直せるように, 新ノードより先に読む.
+     */
+    void readCheckpointDiagram() {
+        int const next = resumeHeader.level;
+        table.clear();
+        table.resize(numVars);
+        nodePool.clear();
+        nodePool.resize(numVars);
+        const0 = TdZddNode(numVars, 0, &const1);
+        const1 = TdZddNode(numVars, &const0, 0);
+        top = &const0;
+
+        std::vector<TdZddNode*> oldNodes(readValue<uint64_t>());
+        if (oldNodes.size() < 2) {
+            throw std::runtime_error("TdZdd: Broken checkpoint");
+        }
+        oldNodes[0] = &const0;
+        oldNodes[1] = &const1;
+
+        for (int i = numVars - 1; i >= next; --i) {
+            uint64_t const n = readValue<uint64_t>();
+            for (uint64_t j = 0; j < n; ++j) {
+                uint64_t const id = readValue<uint64_t>();
+                uint64_t const c0 = readValue<uint64_t>();
+                uint64_t const c1 = readValue<uint64_t>();
+                if (id < 2 || id >= oldNodes.size() || oldNodes[id] != 0
+                        || c0 >= oldNodes.size() || oldNodes[c0] == 0
+                        || c1 >= oldNodes.size() || oldNodes[c1] == 0) {
+                    throw std::runtime_error("TdZdd: Broken checkpoint");
+                }
+                TdZddNode* f = new (nodePool[i].allocate<TdZddNode>()) TdZddNode(
+                        i, oldNodes[c0], oldNodes[c1]);
+                table[i].push_back(f);
+                oldNodes[id] = f;
+            }
+        }
+    }
+
+    /**
+     * チェックポイントの新ノードと未処理ノードを読み込む.
+     * 旧ノードの nodeList は確保済みであること.
+     * @param state フィルタの状態. 未処理ノードの状態はこの複製に読み込む.
+     * @return 次に処理するレベル.
+     */
+    template<typename Subsetter>
+    int readCheckpointNodes(Subsetter const& state) {
+        if (resumeType != typeid(Subsetter).name()) {
+            throw std::runtime_error("TdZdd: Checkpoint of another filter");
+        }
+
+        uint64_t const PENDING = TdZddCheckpointHeader::PENDING;
+        int const next = resumeHeader.level;
+        std::vector<TdZddNode*> newNodes;
+        newNodes.push_back(&const0);
+        newNodes.push_back(&const1);
+
+        for (int i = next - 1; i >= 0; --i) {
+            uint64_t const n = readValue<uint64_t>();
+            for (uint64_t j = 0; j < n; ++j) {
+                uint64_t const r0 = readValue<uint64_t>();
+                uint64_t const r1 = readValue<uint64_t>();
+                if ((r0 != PENDING && r0 >= newNodes.size())
+                        || (r1 != PENDING && r1 >= newNodes.size())) {
+                    throw std::runtime_error("TdZdd: Broken checkpoint");
+                }
+                TdZddNode* f = new (nodePool[i].allocate<TdZddNode>()) TdZddNode(
+                        i, r0 == PENDING ? 0 : newNodes[r0],
+                        r1 == PENDING ? 0 : newNodes[r1]);
+                table[i].push_back(f);
+                newNodes.push_back(f);
+            }
+        }
+
+        uint64_t const topRef = readValue<uint64_t>();
+        if (topRef != PENDING && topRef >= newNodes.size()) {
+            throw std::runtime_error("TdZdd: Broken checkpoint");
+        }
+        top = (topRef == PENDING) ? 0 : newNodes[topRef];
+
+        // 退避する場合, 次の区切りで退避されるレベルの状態は
+        // メモリに置かずに退避ファイルへ直接書く.
+        TdZddPool scratchPool;
+        Subsetter* scratch = spill ? makeCopy(state, scratchPool) : 0;
+        std::vector<TdZddNode*> oldNodes;
+
+        for (int i = next; i < numVars; ++i) {
+            oldNodes.clear();
+            for (TdZddNode* f = table[i].front(); f != 0; f = f->next) {
+                oldNodes.push_back(f);
+            }
+
+            bool const toSpill = spill && i >= next + 2;
+            std::string const path = toSpill ? spill->file(i) : "";
+            std::ofstream so;
+            if (toSpill) {
+                so.open(path.c_str(), std::ios::binary);
+                if (!so) throw std::runtime_error(path + ": Cannot open");
+            }
+
+            uint64_t const n = readValue<uint64_t>();
+            for (uint64_t j = 0; j < n; ++j) {
+                uint64_t const k = readValue<uint64_t>();
+                uint64_t const r = readValue<uint64_t>();
+                if (k >= oldNodes.size()
+                        || (r != PENDING && r / 2 >= newNodes.size())) {
+                    throw std::runtime_error("TdZdd: Broken checkpoint");
+                }
+                TdZddNode** referrer = (r == PENDING) ? &top :
+                                       (r & 1) ? &newNodes[r / 2]->child1 :
+                                                 &newNodes[r / 2]->child0;
+
+                void* mem = newNodePool[0][i].allocate<TdZddNode>();
+                TdZddNode* p;
+                if (toSpill) {
+                    TdZddStateIO<Subsetter>::load(*scratch, *resumeStream);
+                    if (!*resumeStream) throw std::runtime_error(
+                            "TdZdd: Unexpected end of checkpoint");
+                    p = new (mem) TdZddNode(i, 0, referrer);
+                    writeValue<uint64_t>(so, reinterpret_cast<uintptr_t>(p));
+                    TdZddStateIO<Subsetter>::save(*scratch, so);
+                }
+                else {
+                    Subsetter* s = makeCopy(state, workDataPool[0][i]);
+                    TdZddStateIO<Subsetter>::load(*s, *resumeStream);
+                    if (!*resumeStream) throw std::runtime_error(
+                            "TdZdd: Unexpected end of checkpoint");
+                    p = new (mem) TdZddNode(i, s, referrer);
+                }
+                oldNodes[k]->nodeList[0].push_back(p);
+            }
+
+            if (toSpill) {
+                so.close();
+                if (!so) throw std::runtime_error(path + ": Write error");
+                spill->setExists(i, n > 0);
+                if (n == 0) std::remove(path.c_str());
+            }
+        }
+
+        if (scratch) TdZddStateCopy<Subsetter>::destroy(scratch);
+
+        char end[8];
+        resumeStream->read(end, sizeof(end));
+        if (!*resumeStream
+                || std::memcmp(end, TdZddCheckpointHeader::endString(),
+                        sizeof(end)) != 0) {
+            throw std::runtime_error("TdZdd: Broken checkpoint");
+        }
+
+        resumeStream.reset();
+        return next;
+    }
+
+    /**
+     * レベル next-1 の処理を終えた時点の途中経過を書き出す.
+     * 一時ファイルに書いてから置き換えるので, 書き出し中に中断しても
+     * 前回のチェックポイントは失われない.
+     */
+    template<typename Subsetter>
+    void writeCheckpoint(int next) {
+        uint64_t const PENDING = TdZddCheckpointHeader::PENDING;
+        std::string const tmpPath = checkpointPath + ".tmp";
+        std::ofstream os(tmpPath.c_str(), std::ios::binary);
+        if (!os) throw std::runtime_error(tmpPath + ": Cannot open");
+
+        std::string const type = typeid(Subsetter).name();
+        TdZddCheckpointHeader header;
+        header.initialize(numVars, operationCount, next, type.size());
+        writeValue(os, header);
+        os.write(type.data(), type.size());
+
+        // 旧ノード. evalAndSubset() 中は評価値の添字の番号をそのまま使う.
+        const0.tmpId = 0;
+        const1.tmpId = 1;
+        if (evalValues == 0) {
+            size_t id = 2;
+            for (int i = numVars - 1; i >= next; --i) {
+                for (TdZddNode* f = table[i].front(); f != 0; f = f->next) {
+                    f->tmpId = id++;
+                }
+            }
+        }
+        size_t limit = 2;
+        for (int i = numVars - 1; i >= next; --i) {
+            for (TdZddNode* f = table[i].front(); f != 0; f = f->next) {
+                limit = std::max(limit, f->tmpId + 1);
+            }
+        }
+        writeValue<uint64_t>(os, limit);
+        for (int i = numVars - 1; i >= next; --i) {
+            writeValue<uint64_t>(os, table[i].size());
+            for (TdZddNode* f = table[i].front(); f != 0; f = f->next) {
+                writeValue<uint64_t>(os, f->tmpId);
+                writeValue<uint64_t>(os, f->child0->tmpId);
+                writeValue<uint64_t>(os, f->child1->tmpId);
+            }
+        }
+
+        // 未処理ノードの参照元は未設定なので0にして目印とする.
+        for (int i = next; i < numVars; ++i) {
+            for (TdZddNode* f = table[i].front(); f != 0; f = f->next) {
+                for (TdZddNode* p = f->nodeList[0].front(); p != 0;
+                        p = p->next) {
+                    *p->referrer = 0;
+                }
+            }
+        }
+
+        // 新ノード
+        std::vector<std::pair<TdZddNode**,uint64_t>> slots;
+        size_t id = 2;
+        for (int i = next - 1; i >= 0; --i) {
+            writeValue<uint64_t>(os, table[i].size());
+            for (TdZddNode* f = table[i].front(); f != 0; f = f->next) {
+                f->tmpId = id++;
+                writeValue<uint64_t>(os,
+                        f->child0 == 0 ? PENDING : f->child0->tmpId);
+                writeValue<uint64_t>(os,
+                        f->child1 == 0 ? PENDING : f->child1->tmpId);
+                if (f->child0 == 0) {
+                    slots.push_back(std::make_pair(&f->child0, f->tmpId * 2));
+                }
+                if (f->child1 == 0) {
+                    slots.push_back(
+                            std::make_pair(&f->child1, f->tmpId * 2 + 1));
+                }
+            }
+        }
+        std::sort(slots.begin(), slots.end());
+        writeValue<uint64_t>(os, top == 0 ? PENDING : top->tmpId);
+
+        // 未処理ノード. 退避した状態はメモリに読み戻さず, 退避ファイルから
+        // 1つずつ読んで書き出す. 記録の旧ノードの番号は tmpId に置く.
+        auto writePending = [&](TdZddNode const* p, Subsetter const& s) {
+            uint64_t r = PENDING;
+            if (p->referrer != &top) {
+                r = std::lower_bound(slots.begin(), slots.end(),
+                        std::make_pair(p->referrer, uint64_t(0)))->second;
+            }
+            writeValue<uint64_t>(os, p->tmpId);
+            writeValue<uint64_t>(os, r);
+            TdZddStateIO<Subsetter>::save(s, os);
+        };
+
+        TdZddPool scratchPool;
+        Subsetter* scratch = spill ? makeCopy(
+                *static_cast<Subsetter const*>(spillState), scratchPool) : 0;
+
+        for (int i = next; i < numVars; ++i) {
+            uint64_t n = 0;
+            uint64_t j = 0;
+            for (TdZddNode* f = table[i].front(); f != 0; f = f->next, ++j) {
+                for (TdZddNode* p = f->nodeList[0].front(); p != 0;
+                        p = p->next) {
+                    p->tmpId = j;
+                    ++n;
+                }
+            }
+            writeValue<uint64_t>(os, n);
+
+            for (TdZddNode* f = table[i].front(); f != 0; f = f->next) {
+                for (TdZddNode* p = f->nodeList[0].front(); p != 0;
+                        p = p->next) {
+                    if (p->state == 0) continue;
+                    writePending(p,
+                            *reinterpret_cast<Subsetter const*>(p->state));
+                }
+            }
+
+            if (spill && spill->exists(i)) {
+                std::string const path = spill->file(i);
+                std::ifstream is(path.c_str(), std::ios::binary);
+                if (!is) throw std::runtime_error(path + ": Cannot open");
+
+                uint64_t a;
+                while (is.read(reinterpret_cast<char*>(&a), sizeof(a))) {
+                    TdZddStateIO<Subsetter>::load(*scratch, is);
+                    if (!is) throw std::runtime_error(path + ": Read error");
+                    writePending(reinterpret_cast<TdZddNode*>(uintptr_t(a)),
+                            *scratch);
+                }
+                if (!is.eof()) throw std::runtime_error(path + ": Read error");
+            }
+        }
+
+        if (scratch) TdZddStateCopy<Subsetter>::destroy(scratch);
+
+        os.write(TdZddCheckpointHeader::endString(), 8);
+        os.close();
+        if (!os) throw std::runtime_error(tmpPath + ": Write error");
+        if (std::rename(tmpPath.c_str(), checkpointPath.c_str()) != 0) {
+            throw std::runtime_error(checkpointPath + ": Cannot rename");
+        }
+    }
+
+    /**
+     * レベルの区切りで呼び, 間隔に達していればチェックポイントを書き出す.
+     * @param next 次に処理するレベル.
+     */
+    template<typename Subsetter>
+    void checkpoint(int next) {
+        if (checkpointPath.empty()) return;
+        if (!TdZddStateIO<Subsetter>::supported) return;
+
+        ++checkpointLevelCount;
+        bool due = checkpointLevels > 0
+                && checkpointLevelCount >= checkpointLevels;
+        if (checkpointSeconds > 0) {
+            std::chrono::duration<double> elapsed =
+                    std::chrono::steady_clock::now() - checkpointTime;
+            if (elapsed.count() >= checkpointSeconds) due = true;
+        }
+        if (!due) return;
+
+        writeCheckpoint<Subsetter>(next);
+        checkpointLevelCount = 0;
+        checkpointTime = std::chrono::steady_clock::now();
+    }
+
+    /**
+     * レベルの区切りで呼び, レベル next より先の未処理ノードの状態を
+     * ファイルに書き出して, それらのレベルの作業領域を解放する.
+     * 各記録は新ノードのアドレスと状態の組で, 新ノードはメモリに残す.
+     */
+    template<typename Subsetter>
+    void spillStates(int next) {
+        std::vector<TdZddNode*> nodes;
+        for (size_t t = 0; t < spillNodes.size(); ++t) {
+            nodes.insert(nodes.end(), spillNodes[t].begin(), spillNodes[t].end());
+            spillNodes[t].clear();
+        }
+        std::stable_sort(nodes.begin(), nodes.end(),
+                [](TdZddNode const* a, TdZddNode const* b) {
+                    return a->varIndex < b->varIndex;
+                });
+
+        for (size_t j = 0; j < nodes.size();) {
+            int const k = nodes[j]->varIndex;
+            assert(k > next);
+            std::string const path = spill->file(k);
+            std::ofstream os(path.c_str(), std::ios::binary | std::ios::app);
+            if (!os) throw std::runtime_error(path + ": Cannot open");
+
+            for (; j < nodes.size() && nodes[j]->varIndex == k; ++j) {
+                Subsetter* s = reinterpret_cast<Subsetter*>(nodes[j]->state);
+                writeValue<uint64_t>(os, reinterpret_cast<uintptr_t>(nodes[j]));
+                TdZddStateIO<Subsetter>::save(*s, os);
+                TdZddStateCopy<Subsetter>::destroy(s);
+                nodes[j]->state = 0;
+            }
+
+            os.close();
+            if (!os) throw std::runtime_error(path + ": Write error");
+            spill->setExists(k, true);
+        }
+
+        // 先のレベルの状態は全て書き出したので, 不要になった複製ごと解放する
+        for (size_t t = 0; t < workDataPool.size(); ++t) {
+            for (int k = next + 1; k < numVars; ++k) {
+                workDataPool[t][k].clear();
+            }
+        }
+    }
+
+    /**
+     * レベル k の退避した状態を読み戻し, ファイルを削除する.
+     * @param again 次のレベルの区切りで再び退避するか.
+     */
+    template<typename Subsetter>
+    void restoreStates(int k, bool again) {
+        if (!spill->exists(k)) return;
+        std::string const path = spill->file(k);
+        std::ifstream is(path.c_str(), std::ios::binary);
+        if (!is) throw std::runtime_error(path + ": Cannot open");
+
+        Subsetter const& state = *static_cast<Subsetter const*>(spillState);
+        uint64_t p;
+        while (is.read(reinterpret_cast<char*>(&p), sizeof(p))) {
+            TdZddNode* f = reinterpret_cast<TdZddNode*>(uintptr_t(p));
+            Subsetter* s = makeCopy(state, workDataPool[0][k]);
+            TdZddStateIO<Subsetter>::load(*s, is);
+            if (!is) throw std::runtime_error(path + ": Read error");
+            f->state = s;
+            if (again) spillNodes[0].push_back(f);
+        }
+        if (!is.eof()) throw std::runtime_error(path + ": Read error");
+
+        is.close();
+        std::remove(path.c_str());
+        spill->setExists(k, false);
+    }
+
+    /**
+     * レベルの区切りで呼び, 次のレベルの処理後の使用量が上限を超えそうなら
+     * setMemoryBudget() の handler を呼ぶか中断する.
+     * 使用量は TdZddMemoryUsage::resident() で見積もる.
+     * 続ける場合はキャッシュした空きブロックを予測値の残りまで減らし,
+     * 中断する場合は全て解放する.
+     * @param next 次に処理するレベル.
+     * @param poolBytes 前回の呼び出し時にプールが割り当てていたバイト数. 更新する.
+     */
+    template<typename Subsetter>
+    void checkMemory(int next, size_t& poolBytes) {
+        if (memoryBudget == 0) return;
+
+        TdZddMemoryUsage u = memoryUsage();
+        size_t const used = u.total().used;
+        size_t const growth = used > poolBytes ? used - poolBytes : 0;
+        poolBytes = used;
+        u.level = next;
+        u.projected = used + growth;
+        if (u.projected <= memoryBudget) {
+            TdZddPool::trimCache(memoryBudget - u.projected);
+            return;
+        }
+        if (memoryHandler && memoryHandler(u)) return;
+        TdZddPool::releaseCache();
+
+        if (!checkpointPath.empty() && TdZddStateIO<Subsetter>::supported) {
+            writeCheckpoint<Subsetter>(next);
+        }
+        std::ostringstream os;
+        os << "TdZdd: Memory budget exceeded at " << u;
+
+        table.clear();
+        table.resize(numVars);
+        nodePool.clear();
+        nodePool.resize(numVars);
+        newNodePool.clear();
+        workDataPool.clear();
+        nodeListPool.clear();
+        spill.reset();
+        top = &const0;
+        throw std::runtime_error(os.str());
+    }
+
+    /**
+     * レベル毎に並列化したトップダウン構築.
+     * 各レベルで, まず新ノードの重複を並列ハッシュ表で一括して除去し,
+     * 次に新ノードの列をスレッド数で等分して子ノードを生成する.
+     * 各スレッドは専用のプールとノードリストを使い,
+     * レベル毎にスレッド番号順に連結することで逐次処理と同じ順序の結果を得る.
+     */
     template<typename Subsetter, typename T>
     void doSubset(Subsetter const& state) {
-        if (top == &const0 || top == &const1) return;
+        bool const resumed = resuming();
+        if (!resumed && (top == &const0 || top == &const1)) return;
+
+        int const nt = threads();
+        newNodePool.resize(nt);
+        workDataPool.resize(nt);
+        touchedNodes.resize(nt);
+        for (int t = 0; t < nt; ++t) {
+            newNodePool[t].resize(numVars);
+            workDataPool[t].resize(numVars);
+        }
+
+        nodeListPool.resize(numVars);
+        spill.reset();
+        spillNodes.clear();
+        if (!spillDirectory.empty() && TdZddStateIO<Subsetter>::supported) {
+            spill.reset(new SpillArea(spillDirectory, numVars));
+            spillNodes.resize(nt);
+            spillState = &state;
+        }
 
         for (int i = 0; i < numVars; ++i) {
             for (TdZddNode* f = table[i].front(); f != 0; f = f->next) {
-                f->nodeList =
-                        new (workDataPool[i].allocate<TdZddNodeList>()) TdZddNodeList();
+                f->nodeList = nodeListPool[i].allocate<TdZddNodeList>(nt);
+                for (int t = 0; t < nt; ++t) {
+                    new (f->nodeList + t) TdZddNodeList();
+                }
             }
         }
 
-        Subsetter* s = makeCopy(state, workDataPool[top->varIndex]);
-        if (top->varIndex == 0) {
-            void* mem = newNodePool[0].allocate<TdZddNode>();
-            TdZddNode* newToNode = new (mem) TdZddNode(0, s, &top);
-            top->nodeList->push_back(newToNode);
+        int first = 0;
+        if (resumed) {
+            first = readCheckpointNodes(state);
         }
         else {
-            doSubsetEdge<Subsetter,T>(s, top->varIndex, false, 0, top, &top);
+            Subsetter* s = makeCopy(state, workDataPool[0][top->varIndex]);
+            if (top->varIndex == 0) {
+                void* mem = newNodePool[0][0].allocate<TdZddNode>();
+                TdZddNode* newToNode = new (mem) TdZddNode(0, s, &top);
+                top->nodeList[0].push_back(newToNode);
+            }
+            else {
+                doSubsetEdge<Subsetter,T>(s, top->varIndex, false, 0, top,
+                        &top, 0);
+            }
         }
+        checkpointLevelCount = 0;
+        checkpointTime = std::chrono::steady_clock::now();
 
-        //TdZddHashMap<Subsetter const*,TdZddNode*> uniq(1000000);
+        std::vector<TdZddNode*> oldNodes;
+        WorkList work;
+        std::vector<size_t> slot;
         TdZddHashMap<Subsetter const*,TdZddNode*> uniq;
+        TdZddConcurrentHashTable<UniqKeys<Subsetter>> cuniq;
+        size_t builtNodes = 0;
+        size_t sweepLimit = 1024;
+        size_t poolBytes = memoryBudget > 0 ? memoryUsage().total().used : 0;
 
         //MessageHandler mh;//TODO
-        for (int i = 0; i < numVars; ++i) {
+        for (int i = first; i < numVars; ++i) {
             TdZddNodeList& list = table[i];
             TdZddNodeList newNodeList;
             //mh.begin("Level") << " " << i << " ...";//TODO
+            if (spill) restoreStates<Subsetter>(i, false);
 
-            for (TdZddNode* oldNode = list.front(); oldNode != 0; oldNode =
-                    oldNode->next) {
-                TdZddNodeList* nl = oldNode->nodeList;
-                size_t const m = nl->size();
+            oldNodes.clear();
+            for (TdZddNode* f = list.front(); f != 0; f = f->next) {
+                oldNodes.push_back(f);
+            }
+            long const n = oldNodes.size();
+
+            if (nt == 1) {
+                for (long j = 0; j < n; ++j) {
+                    TdZddNode* oldNode = oldNodes[j];
+                    doUniq(oldNode->nodeList[0], uniq);
 
-                if (m == 1) {
-                    TdZddNode* newNode = nl->front();
-                    Subsetter* s = reinterpret_cast<Subsetter*>(newNode->state);
-                    *newNode->referrer = newNode;
-                    doSubsetNode<Subsetter,T>(s, oldNode, newNode);
+                    for (TdZddNode* f = oldNode->nodeList[0].front(); f != 0;
+                            f = f->next) {
+                        Subsetter* s = reinterpret_cast<Subsetter*>(f->state);
+                        doSubsetNode<Subsetter,T>(s, oldNode, f, 0);
+                    }
                 }
-                else if (m != 0) {
-                    uniq.initialize(m);
+            }
+            else {
+                work.clear();
+                for (long j = 0; j < n; ++j) {
+                    TdZddNode* oldNode = oldNodes[j];
+                    TdZddNodeList* nl = oldNode->nodeList;
+                    for (TdZddNode* f = nl[0].front(); f != 0; f = f->next) {
+                        work.push_back(std::make_pair(oldNode, f));
+                    }
+                    nl[0].clear();
+                }
+                long const m0 = work.size();
 
-                    for (TdZddNodeList::iterator p = nl->begin();
-                            p != nl->end();) {
-                        TdZddNode* newNode = *p;
-                        Subsetter* s =
-                                reinterpret_cast<Subsetter*>(newNode->state);
+                UniqKeys<Subsetter> keys(work);
+                cuniq.initialize(keys, m0);
+                slot.resize(m0);
 
-                        TdZddNode* uniqNewNode = uniq.put(s, newNode);
-                        *newNode->referrer = uniqNewNode;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+                for (long j = 0; j < m0; ++j) {
+                    slot[j] = cuniq.add(j);
+                }
 
-                        if (uniqNewNode == newNode) {
-                            ++p;
-                        }
-                        else {
-                            nl->erase(p);
-                            s->~Subsetter();
-                        }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+                for (long j = 0; j < m0; ++j) {
+                    size_t const r = cuniq.representative(slot[j]);
+                    TdZddNode* newNode = work[j].second;
+                    *newNode->referrer = work[r].second;
+                    slot[j] = r;
+                }
+
+                size_t m = 0;
+                for (long j = 0; j < m0; ++j) {
+                    TdZddNode* newNode = work[j].second;
+                    if (slot[j] == size_t(j)) {
+                        work[j].first->nodeList[0].push_back(newNode);
+                        work[m++] = work[j];
                     }
+                    else {
+                        TdZddStateCopy<Subsetter>::destroy(
+                                reinterpret_cast<Subsetter*>(newNode->state));
+                    }
+                }
+                work.resize(m);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+                {
+#ifdef _OPENMP
+                    int const tid = omp_get_thread_num();
+                    int const nth = omp_get_num_threads();
+#else
+                    int const tid = 0;
+                    int const nth = 1;
+#endif
+                    size_t const b = m * tid / nth;
+                    size_t const e = m * (tid + 1) / nth;
+
+                    for (size_t j = b; j < e; ++j) {
+                        TdZddNode* f = work[j].second;
+                        Subsetter* s = reinterpret_cast<Subsetter*>(f->state);
+                        doSubsetNode<Subsetter,T>(s, work[j].first, f, tid);
+                    }
+                }
 
-                    for (TdZddNode* newNode = nl->front(); newNode != 0;
-                            newNode = newNode->next) {
-                        Subsetter* s =
-                                reinterpret_cast<Subsetter*>(newNode->state);
-                        doSubsetNode<Subsetter,T>(s, oldNode, newNode);
+                for (int t = 1; t < nt; ++t) {
+                    std::vector<TdZddNode*>& touched = touchedNodes[t];
+                    for (size_t j = 0; j < touched.size(); ++j) {
+                        TdZddNodeList* nl = touched[j]->nodeList;
+                        nl[0].splice(nl[t]);
                     }
+                    touched.clear();
                 }
+            }
 
-                newNodeList.splice(*nl);
-                nl->~TdZddNodeList();
+            for (long j = 0; j < n; ++j) {
+                TdZddNodeList* nl = oldNodes[j]->nodeList;
+                newNodeList.splice(nl[0]);
+                for (int t = 0; t < nt; ++t) {
+                    nl[t].~TdZddNodeList();
+                }
             }
 
             list.clear();
             list.splice(newNodeList);
             nodePool[i].clear();
-            nodePool[i].splice(newNodePool[i]);
-            workDataPool[i].clear();
+            for (int t = 0; t < nt; ++t) {
+                nodePool[i].splice(newNodePool[t][i]);
+                workDataPool[t][i].clear();
+            }
+            nodeListPool[i].clear();
             //mh.end(list.size());//TODO
+
+            // 構築済みのノードが前回の除去後の一定倍に達する毎に死んだノードを除く.
+            // 除去できたノードが少なければ間隔を広げる.
+            // 最後のレベルの後は直後の既約化で領域を返すので詰め直さない.
+            builtNodes += list.size();
+            if (i + 1 == numVars) {
+                sweepDeadNodes(i, false);
+            }
+            else if (builtNodes >= sweepLimit) {
+                size_t const swept = builtNodes;
+                builtNodes = sweepDeadNodes(i);
+                size_t const factor = (swept - builtNodes) * 8 >= swept ? 2 : 8;
+                sweepLimit = std::max(builtNodes * factor, sweepLimit);
+            }
+
+            if (i + 1 < numVars) {
+                checkpoint<Subsetter>(i + 1);
+                if (spill) spillStates<Subsetter>(i + 1);
+                checkMemory<Subsetter>(i + 1, poolBytes);
+            }
         }
+
+        spill.reset();
     }
 
 public:
     template<typename Subsetter>
     void subset(Subsetter const& state) {
+        if (skipOperation()) return;
+        if (resuming()) readCheckpointDiagram();
         doSubset<Subsetter,void>(state);
     }
 
     template<typename Eval, typename Subsetter>
     void evalAndSubset(Eval const& eval, Subsetter const& state) {
         typedef typename Eval::ValueType ValueType;
-        EvalRunner<Eval,ValueType> evalContext;
-        evalContext(*this, eval);
+        if (skipOperation()) return;
+        if (resuming()) readCheckpointDiagram();
+        EvalValues<ValueType> values(*this, doEval<Eval,ValueType>(eval));
+        evalValues = values.get();
         doSubset<Subsetter,ValueType>(state);
+        evalValues = 0;
     }
 
     template<typename ES>
@@ -432,10 +1498,148 @@ public:
         evalAndSubset(es, es);
     }
 
-    void reduce() {
+private:
+    /**
+     * レベル内のノードの並列ハッシュ表用のキー.
+     */
+    class NodeKeys {
+        std::vector<TdZddNode*> const& nodes;
+
+    public:
+        NodeKeys(std::vector<TdZddNode*> const& nodes)
+                : nodes(nodes) {
+        }
+
+        size_t hashCode(size_t i) const {
+            return nodes[i]->hashCode();
+        }
+
+        bool equals(size_t i, size_t j) const {
+            return nodes[i]->equals(*nodes[j]);
+        }
+    };
+
+    /**
+     * レベル毎に並列化したボトムアップ既約化.
+     * 各レベルで, 子ノードの置換, 並列ハッシュ表による共有,
+     * 生き残ったノードの詰め直しをそれぞれ並列に行う.
+     * 等価なノードはリスト中で最初のものを代表とするので,
+     * 結果は逐次処理と一致する.
+     */
+    void reduceMP() {
+        std::vector<TdZddNode*> nodes;
+        std::vector<TdZddNode*> kept;
+        std::vector<size_t> slot;
+        std::vector<size_t> offset;
+        NodeKeys keys(nodes);
+        TdZddConcurrentHashTable<NodeKeys> cuniq;
+        size_t const none = size_t(-1);
+
+        for (int i = numVars - 1; i >= 0; --i) {
+            TdZddNodeList& list = table[i];
+            if (list.empty()) continue;
+
+            nodes.clear();
+            for (TdZddNode* f = list.front(); f != 0; f = f->next) {
+                nodes.push_back(f);
+            }
+            long const n = nodes.size();
+            slot.resize(n);
+            cuniq.initialize(keys, n);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+            for (long j = 0; j < n; ++j) {
+                TdZddNode* f = nodes[j];
+                f->child1 = f->child1->tmpNodePtr;
+                if (f->child1 == &const0) {
+                    f->tmpNodePtr = f->child0->tmpNodePtr;
+                }
+                else {
+                    f->child0 = f->child0->tmpNodePtr;
+                }
+            }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+            for (long j = 0; j < n; ++j) {
+                slot[j] = (nodes[j]->child1 == &const0) ? none : cuniq.add(j);
+            }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+            for (long j = 0; j < n; ++j) {
+                if (slot[j] == none) continue;
+                size_t const r = cuniq.representative(slot[j]);
+                nodes[j]->tmpNodePtr = nodes[r];
+            }
+
+            kept.resize(n);
+            offset.assign(threads() + 1, 0);
+            size_t m = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+            {
+#ifdef _OPENMP
+                int const tid = omp_get_thread_num();
+                int const nth = omp_get_num_threads();
+#else
+                int const tid = 0;
+                int const nth = 1;
+#endif
+                long const b = n * tid / nth;
+                long const e = n * (tid + 1) / nth;
+
+                size_t c = 0;
+                for (long j = b; j < e; ++j) {
+                    if (nodes[j]->tmpNodePtr == nodes[j]) ++c;
+                }
+                offset[tid + 1] = c;
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+                {
+                    for (int t = 0; t < nth; ++t) {
+                        offset[t + 1] += offset[t];
+                    }
+                    m = offset[nth];
+                }
+
+                size_t k = offset[tid];
+                for (long j = b; j < e; ++j) {
+                    if (nodes[j]->tmpNodePtr == nodes[j]) kept[k++] = nodes[j];
+                }
+
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+                for (size_t k = offset[tid]; k < offset[tid + 1]; ++k) {
+                    kept[k]->next = (k + 1 < m) ? kept[k + 1] : 0;
+                }
+            }
+
+            list.assign(m ? kept[0] : 0, m ? kept[m - 1] : 0, m);
+        }
+
+        top = top->tmpNodePtr;
+    }
+
+    void doReduce() {
         const0.tmpNodePtr = &const0;
         const1.tmpNodePtr = &const1;
 
+        if (threads() > 1) {
+            reduceMP();
+            return;
+        }
+
         //TdZddHashSet<TdZddNode*> uniq(1000000);
         TdZddHashSet<TdZddNode*> uniq;
 
@@ -474,6 +1678,12 @@ public:
         }
     }
 
+public:
+    void reduce() {
+        if (skipOperation()) return;
+        doReduce();
+    }
+
     size_t size() {
         size_t n = 0;
         for (int i = 0; i < numVars; ++i) {
@@ -483,13 +1693,8 @@ public:
     }
 
 private:
-    struct DeadNodeCounter {
+    struct AliveChecker {
         typedef bool ValueType;
-        size_t count;
-
-        DeadNodeCounter()
-                : count(0) {
-        }
 
         ValueType value0() const {
             return false;
@@ -499,18 +1704,27 @@ private:
             return true;
         }
 
-        ValueType value(int k0, ValueType v0, int k1, ValueType v1, int k) {
-            if (v0 || v1) return true;
-            ++count;
-            return false;
+        ValueType value(int k0, ValueType v0, int k1, ValueType v1,
+                int k) const {
+            return v0 || v1;
         }
     };
 
 public:
     size_t deadSize() {
-        DeadNodeCounter dnc;
-        evaluate(dnc);
-        return dnc.count;
+        AliveChecker const checker;
+        EvalValues<bool> alive(*this, doEval<AliveChecker,bool>(checker));
+        long const n = evalSize;
+        size_t count = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) reduction(+:count) if (threads() > 1)
+#endif
+        for (long j = 2; j < n; ++j) {
+            if (!alive[j]) ++count;
+        }
+
+        return count;
     }
 
 private:
@@ -630,7 +1844,58 @@ public:
         return const_iterator(*this, false);
     }
 
+    /**
+     * 既約化済みのZDDをバイナリ形式で1パスで書き出す.
+     * 形式は TdZddFile.hpp を参照. ノード番号はノード数に応じて
+     * 4または8バイトとし, 4バイトのものは TdZddFrozen で読み込める.
+     * @param os 出力先.
+     * @param meta メタデータ.
+     */
+    void save(std::ostream& os, std::string const& meta = "") {
+        numberNodes();
+        if (evalSize - 1 <= uint32_t(-1)) {
+            doSave<uint32_t>(os, meta);
+        }
+        else {
+            doSave<uint64_t>(os, meta);
+        }
+    }
+
 private:
+    template<typename Id>
+    void doSave(std::ostream& os, std::string const& meta) {
+        size_t const BUFFER_SIZE = 1 << 16;
+        TdZddFileWriter w(os);
+
+        TdZddFileHeader h;
+        h.initialize(sizeof(Id), numVars, evalSize, top->tmpId, meta.size());
+        w.write(&h, sizeof(h));
+        w.write(meta.data(), meta.size());
+        w.pad();
+
+        std::vector<Id> buf(numVars + 1);
+        buf[numVars] = 2;
+        for (int i = numVars - 1; i >= 0; --i) {
+            buf[i] = buf[i + 1] + table[i].size();
+        }
+        w.write(buf.data(), buf.size() * sizeof(Id));
+        w.pad();
+
+        buf.assign(4, 0);
+        for (int i = numVars - 1; i >= 0; --i) {
+            for (TdZddNode const* f = table[i].front(); f != 0; f = f->next) {
+                buf.push_back(f->child0->tmpId);
+                buf.push_back(f->child1->tmpId);
+                if (buf.size() >= BUFFER_SIZE) {
+                    w.write(buf.data(), buf.size() * sizeof(Id));
+                    buf.clear();
+                }
+            }
+        }
+        w.write(buf.data(), buf.size() * sizeof(Id));
+        w.finish();
+    }
+
     struct DumpLabeler {
         int operator()(int i) {
             return i;
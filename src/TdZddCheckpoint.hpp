@@ -0,0 +1,123 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: TdZddCheckpoint.hpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#ifndef TDZDDCHECKPOINT_HPP_
+#define TDZDDCHECKPOINT_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+/*
+ * トップダウン構築の途中経過のファイル形式 (全て実行環境のバイト順).
+ *   ヘッダ          TdZddCheckpointHeader
+ *   状態の型名      typeBytes バイト
+ *   旧ノード数の上限 uint64_t
+ *   旧ノード        レベル numVars-1 から level まで,
+ *                   ノード数と (番号, 0枝, 1枝) の組の列
+ *   新ノード        レベル level-1 から 0 まで,
+ *                   ノード数と (0枝, 1枝) の新ノードの参照の組の列
+ *   始点            新ノードの参照
+ *   未処理ノード    レベル level 以降のレベル毎に,
+ *                   ノード数と (旧ノード, 参照元, 状態) の組の列
+ *   終端            "TDZDDEND"
+ * 旧ノードの番号は0と1が終端ノードで, その他は任意の重複しない値.
+ * 新ノードの参照は0と1が終端ノード, PENDING が未処理ノードで,
+ * その他は書き出した順に2から振った番号.
+ * 未処理ノードの旧ノードはそのレベルの旧ノードを書き出した順に0から振った番号.
+ * 未処理ノードの参照元は新ノードの番号*2+枝, または始点を表す PENDING.
+ */
+struct TdZddCheckpointHeader {
+    char magic[8];      ///< "TDZDDCKP".
+    uint32_t version;   ///< 形式の版.
+    uint32_t byteOrder; ///< BYTE_ORDER_MARK. バイト順の確認用.
+    uint64_t numVars;   ///< 変数の数.
+    uint64_t operation; ///< 何回目の操作の途中か.
+    uint64_t level;     ///< 次に処理するレベル.
+    uint64_t typeBytes; ///< 状態の型名のバイト数.
+
+    static uint32_t const VERSION = 2;
+    static uint32_t const BYTE_ORDER_MARK = 0x01020304;
+    static uint64_t const PENDING = ~uint64_t(0);
+
+    static char const* magicString() {
+        return "TDZDDCKP";
+    }
+
+    static char const* endString() {
+        return "TDZDDEND";
+    }
+
+    void initialize(uint64_t numVars, uint64_t operation, uint64_t level,
+            uint64_t typeBytes) {
+        std::memset(this, 0, sizeof(*this));
+        std::memcpy(magic, magicString(), sizeof(magic));
+        this->version = VERSION;
+        this->byteOrder = BYTE_ORDER_MARK;
+        this->numVars = numVars;
+        this->operation = operation;
+        this->level = level;
+        this->typeBytes = typeBytes;
+    }
+
+    bool valid() const {
+        return std::memcmp(magic, magicString(), sizeof(magic)) == 0
+                && version == VERSION && byteOrder == BYTE_ORDER_MARK;
+    }
+};
+
+/**
+ * フィルタの状態の保存と復元.
+ * 状態が save(std::ostream&) const と load(std::istream&) を持つ場合に使える.
+ * load() は同じフィルタを複製した状態に対して呼ばれる.
+ */
+template<typename S>
+class TdZddStateIO {
+    template<typename T>
+    static auto test(int)
+    -> decltype(std::declval<T const&>().save(std::declval<std::ostream&>()),
+            std::declval<T&>().load(std::declval<std::istream&>()),
+            std::true_type());
+
+    template<typename T>
+    static std::false_type test(...);
+
+    typedef decltype(test<S>(0)) Supported;
+
+    static void save(S const& s, std::ostream& os, std::true_type) {
+        s.save(os);
+    }
+
+    static void save(S const& s, std::ostream& os, std::false_type) {
+        throw std::runtime_error("TdZdd: State cannot be saved");
+    }
+
+    static void load(S& s, std::istream& is, std::true_type) {
+        s.load(is);
+    }
+
+    static void load(S& s, std::istream& is, std::false_type) {
+        throw std::runtime_error("TdZdd: State cannot be loaded");
+    }
+
+public:
+    static bool const supported = Supported::value;
+
+    static void save(S const& s, std::ostream& os) {
+        save(s, os, Supported());
+    }
+
+    static void load(S& s, std::istream& is) {
+        load(s, is, Supported());
+    }
+};
+
+#endif /* TDZDDCHECKPOINT_HPP_ */
@@ -0,0 +1,118 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: TdZddConcurrentHash.hpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#ifndef TDZDDCONCURRENTHASH_HPP_
+#define TDZDDCONCURRENTHASH_HPP_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+#include "TdZddHash.hpp"
+
+/**
+ * 複数スレッドから同時に挿入できるオープンアドレス法のハッシュ表.
+ * 要素は外部の配列の添字で表し, 空きスロットはCASで確保する.
+ * キーの比較には Keys::hashCode(i) と Keys::equals(i, j) を用いる.
+ * 等価な要素が複数挿入された場合は最小の添字を代表とするので,
+ * 挿入が完了した後の結果はスレッドの実行順序によらない.
+ */
+template<typename Keys>
+class TdZddConcurrentHashTable {
+    Keys const* keys;
+    size_t size_;
+    size_t capacity_;
+    std::atomic<size_t>* table; ///< 添字+1 (0は空きスロット).
+
+    TdZddConcurrentHashTable(TdZddConcurrentHashTable const&);
+    TdZddConcurrentHashTable& operator=(TdZddConcurrentHashTable const&);
+
+public:
+    TdZddConcurrentHashTable()
+            : keys(0), size_(0), capacity_(0), table(0) {
+    }
+
+    virtual ~TdZddConcurrentHashTable() {
+        delete[] table;
+    }
+
+    /**
+     * 表を空にする. スレッドセーフではない.
+     * @param k キー集合.
+     * @param maxItems 挿入する要素数の上限.
+     */
+    void initialize(Keys const& k, size_t maxItems) {
+        keys = &k;
+        size_ = 16;
+        while (size_ < maxItems * 2) {
+            size_ <<= 1;
+        }
+
+        if (size_ > capacity_) {
+            capacity_ = size_;
+            delete[] table;
+            table = new std::atomic<size_t>[capacity_];
+        }
+
+        for (size_t i = 0; i < size_; ++i) {
+            table[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * 要素を挿入する. 複数スレッドから同時に呼び出せる.
+     * @param i 要素の添字.
+     * @return 要素が格納されたスロットの番号.
+     */
+    size_t add(size_t i) {
+        size_t const mask = size_ - 1;
+        size_t const item = i + 1;
+        size_t k = hashMix(keys->hashCode(i)) & mask;
+
+        for (;;) {
+            size_t cur = table[k].load(std::memory_order_acquire);
+
+            if (cur == 0) {
+                if (table[k].compare_exchange_strong(cur, item,
+                        std::memory_order_acq_rel)) return k;
+                // 他のスレッドが先に確保した場合は cur が更新されている
+            }
+
+            if (keys->equals(cur - 1, i)) {
+                while (item < cur) {
+                    if (table[k].compare_exchange_weak(cur, item,
+                            std::memory_order_acq_rel)) break;
+                }
+                return k;
+            }
+
+            k = (k + 1) & mask;
+        }
+    }
+
+    /**
+     * スロットの代表要素を得る. 全ての挿入が完了してから呼び出すこと.
+     * @param k add() が返したスロットの番号.
+     * @return 代表要素の添字.
+     */
+    size_t representative(size_t k) const {
+        assert(k < size_);
+        size_t const item = table[k].load(std::memory_order_acquire);
+        assert(item != 0);
+        return item - 1;
+    }
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+};
+
+#endif /* TDZDDCONCURRENTHASH_HPP_ */
@@ -0,0 +1,332 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: TdZddCounter.hpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#ifndef TDZDDCOUNTER_HPP_
+#define TDZDDCOUNTER_HPP_
+
+#include "TdZddHash.hpp"
+#include "TdZddPool.hpp"
+#include "util/BigNumber.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * ZDDを構築せずに, フィルタを満たす組合せの数を数える.
+ * 全組合せの族に TdZdd::subset() を適用した場合と同じ順序で down() を呼び,
+ * そのZDDの1終端への経路の数を求める.
+ * 状態と場合の数の表はまだ処理していないレベルの分だけを持ち,
+ * 処理を終えたレベルの表は直ちに解放する.
+ * TdZdd::subset() と同様に, 状態の重複はレベルの処理を始める時にまとめて除く.
+ * 場合の数はレベル毎の表に limb (64ビット語) の列として同じ幅で詰めて持つ.
+ * 幅は2 limb (128ビット) から始め, 桁あふれした表だけをその場で1 limb 広げる.
+ */
+class TdZddCounter {
+    /**
+     * 幅 na の limb の列 a に幅 nb (nb <= na) の列 b を足す.
+     * @return 最上位から桁あふれしたらtrue.
+     */
+    static bool addLimbs(uint64_t* a, int na, uint64_t const* b, int nb) {
+        if (na == 2 && nb == 2) {
+            unsigned __int128 x, y;
+            std::memcpy(&x, a, sizeof(x));
+            std::memcpy(&y, b, sizeof(y));
+            x += y;
+            std::memcpy(a, &x, sizeof(x));
+            return x < y;
+        }
+
+        uint64_t carry = 0;
+        int i = 0;
+        for (; i < nb; ++i) {
+            uint64_t const s = a[i] + b[i];
+            uint64_t const t = s + carry;
+            carry = (s < b[i]) | (t < s);
+            a[i] = t;
+        }
+        for (; carry != 0 && i < na; ++i) {
+            carry = (++a[i] == 0);
+        }
+        return carry != 0;
+    }
+
+    /**
+     * 場合の数を limb の列 a に足す. 桁あふれしたら a を1 limb 広げる.
+     */
+    static void addTo(std::vector<uint64_t>& a, uint64_t const* b, int nb) {
+        if (a.size() < size_t(nb)) a.resize(nb);
+        if (addLimbs(a.data(), a.size(), b, nb)) a.push_back(1);
+    }
+
+    /**
+     * レベル毎の状態と場合の数の表.
+     * 場合の数は1つ当たり width 個の limb を下位から並べて counts に詰める.
+     */
+    template<typename Subsetter>
+    class Level {
+        TdZddPool pool_;
+        std::vector<Subsetter*> states;
+        std::vector<uint64_t> counts;
+        std::vector<uint64_t const*> sources; ///< merge() 前の場合の数の参照先.
+        int width;          ///< 場合の数1つ当たりの limb の数.
+        int sourceWidth;    ///< sources の参照先の limb の数.
+        TdZddHashMap<Subsetter const*,size_t> uniq;
+
+        Level(Level const&);
+        Level& operator=(Level const&);
+
+        /**
+         * 全ての場合の数を w limb に広げる.
+         */
+        void widen(int w) {
+            size_t const n = counts.size() / width;
+            std::vector<uint64_t> v(n * w);
+            for (size_t j = 0; j < n; ++j) {
+                std::copy(&counts[j * width], &counts[j * width] + width,
+                        &v[j * w]);
+            }
+            counts.swap(v);
+            width = w;
+        }
+
+        /**
+         * j 番目の場合の数に b を足す. 桁あふれしたら表全体を広げる.
+         * b はこの表の中を指してもよい.
+         */
+        void addCount(size_t j, uint64_t const* b, int nb) {
+            if (addLimbs(&counts[j * width], width, b, nb)) {
+                widen(width + 1);
+                counts[j * width + width - 1] = 1;
+            }
+        }
+
+    public:
+        Level()
+                : width(2), sourceWidth(0) {
+        }
+
+        virtual ~Level() {
+            for (size_t j = 0; j < states.size(); ++j) {
+                TdZddStateCopy<Subsetter>::destroy(states[j]);
+            }
+        }
+
+        TdZddPool& pool() {
+            return pool_;
+        }
+
+        size_t size() const {
+            return states.size();
+        }
+
+        Subsetter const& state(size_t j) const {
+            return *states[j];
+        }
+
+        uint64_t const* count(size_t j) const {
+            return &counts[j * width];
+        }
+
+        int countWidth() const {
+            return width;
+        }
+
+        /**
+         * 状態と場合の数を追加する. 重複は merge() で除去する.
+         * @param s pool() 上の状態.
+         * @param c 場合の数の limb の列.
+         * @param w c の limb の数.
+         */
+        void add(Subsetter* s, uint64_t const* c, int w) {
+            if (w > width) widen(w);
+            states.push_back(s);
+            sources.push_back(0);
+            counts.insert(counts.end(), c, c + w);
+            counts.resize(states.size() * width);
+        }
+
+        /**
+         * 状態と場合の数の参照を追加する. 重複は merge() で除去する.
+         * @param s pool() 上の状態.
+         * @param c 場合の数の limb の列. merge() まで参照し続ける.
+         * @param w c の limb の数.
+         */
+        void addRef(Subsetter* s, uint64_t const* c, int w) {
+            states.push_back(s);
+            sources.push_back(c);
+            counts.resize(states.size() * width);
+            if (w > sourceWidth) sourceWidth = w;
+        }
+
+        /**
+         * 同じ状態をまとめ, 場合の数を合計する.
+         * 全ての状態が揃ってから一度に行うので, ハッシュ表の大きさが決まる.
+         */
+        void merge() {
+            if (sourceWidth > width) widen(sourceWidth);
+            size_t const m = states.size();
+            uniq.initialize(m);
+
+            size_t n = 0;
+            for (size_t j = 0; j < m; ++j) {
+                size_t const r = uniq.put(states[j], n);
+                if (r == n) {
+                    states[n] = states[j];
+                    uint64_t* d = &counts[n * width];
+                    if (sources[j]) {
+                        std::copy(sources[j], sources[j] + sourceWidth, d);
+                        std::fill(d + sourceWidth, d + width, 0);
+                    }
+                    else if (n != j) {
+                        std::copy(&counts[j * width], &counts[j * width] + width,
+                                d);
+                    }
+                    ++n;
+                }
+                else {
+                    if (sources[j]) addCount(r, sources[j], sourceWidth);
+                    else addCount(r, &counts[j * width], width);
+                    TdZddStateCopy<Subsetter>::destroy(states[j]);
+                }
+            }
+
+            states.resize(n);
+            counts.resize(n * width);
+            sources.assign(n, 0);
+            sourceWidth = 0;
+        }
+    };
+
+    int numVars;        ///< 変数の数.
+    size_t peakStates_; ///< 同時に保持した状態の数の最大値 (重複を含む).
+
+    template<typename Subsetter>
+    static Subsetter* makeCopy(Subsetter const& state, TdZddPool& pool) {
+        return TdZddStateCopy<Subsetter>::copy(state, pool);
+    }
+
+    /**
+     * 組合せの数を数える.
+     * @param state フィルタの初期状態.
+     * @param total 組合せの数の limb の列の格納先.
+     */
+    template<typename Subsetter>
+    void doCount(Subsetter const& state, std::vector<uint64_t>& total) {
+        typedef Level<Subsetter> Table;
+        uint64_t const one = 1;
+        peakStates_ = 0;
+        total.assign(1, one);
+        if (numVars == 0) return;
+        total.clear();
+
+        std::vector<std::unique_ptr<Table>> levels(numVars);
+        size_t live = 1;
+
+        levels[0].reset(new Table());
+        levels[0]->add(makeCopy(state, levels[0]->pool()), &one, 1);
+
+        // 直前に処理したレベル. 次のレベルの merge() まで場合の数を参照される.
+        std::unique_ptr<Table> done;
+
+        for (int i = 0; i < numVars; ++i) {
+            Table* level = levels[i].get();
+            if (level == 0) continue;
+            live -= level->size();
+            level->merge();
+            live += level->size();
+            if (done) {
+                live -= done->size();
+                done.reset();
+            }
+
+            int const i1 = i + 1;
+            Table* next = 0;
+            if (i1 < numVars) {
+                if (!levels[i1]) levels[i1].reset(new Table());
+                next = levels[i1].get();
+            }
+
+            for (size_t j = 0; j < level->size(); ++j) {
+                for (int take = 0; take <= 1; ++take) {
+                    // 大半の枝は次のレベルに進むので, その表に複製しておく.
+                    // POD の状態はスタック上で試し, 生き残った場合だけ複製する.
+                    typename std::aligned_storage<sizeof(Subsetter),
+                            alignof(Subsetter)>::type buf;
+                    TdZddPool& pool = next ? next->pool() : level->pool();
+                    Subsetter* s = TdZddStateCopy<Subsetter>::pod ?
+                            static_cast<Subsetter*>(std::memcpy(&buf,
+                                    &level->state(j), sizeof(Subsetter))) :
+                            makeCopy(level->state(j), pool);
+                    int k = s->down(take, i, i1);
+
+                    if (k == 0) {
+                        TdZddStateCopy<Subsetter>::destroy(s);
+                    }
+                    else if (k < 0 || k >= numVars) {
+                        TdZddStateCopy<Subsetter>::destroy(s);
+                        addTo(total, level->count(j), level->countWidth());
+                    }
+                    else {
+                        if (!levels[k]) levels[k].reset(new Table());
+                        Table* to = levels[k].get();
+                        if (to == next) {
+                            if (TdZddStateCopy<Subsetter>::pod) {
+                                s = makeCopy(*s, to->pool());
+                            }
+                            to->addRef(s, level->count(j), level->countWidth());
+                        }
+                        else {
+                            Subsetter* t = makeCopy(*s, to->pool());
+                            TdZddStateCopy<Subsetter>::destroy(s);
+                            to->add(t, level->count(j), level->countWidth());
+                        }
+                        ++live;
+                    }
+                }
+            }
+
+            if (live > peakStates_) peakStates_ = live;
+            done = std::move(levels[i]);
+        }
+    }
+
+public:
+    TdZddCounter(int n)
+            : numVars(n), peakStates_(0) {
+    }
+
+    int variables() const {
+        return numVars;
+    }
+
+    /**
+     * 直前の count() で同時に保持した状態の数の最大値.
+     */
+    size_t peakStates() const {
+        return peakStates_;
+    }
+
+    /**
+     * 組合せの数を数える.
+     * @param state フィルタの初期状態.
+     * @return フィルタを満たす組合せの数.
+     */
+    template<typename Subsetter>
+    BigNumber count(Subsetter const& state) {
+        std::vector<uint64_t> total;
+        doCount(state, total);
+        return BigNumber(total.data(), total.size());
+    }
+};
+
+#endif /* TDZDDCOUNTER_HPP_ */
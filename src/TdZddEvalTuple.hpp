@@ -0,0 +1,78 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: TdZddEvalTuple.hpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#ifndef TDZDDEVALTUPLE_HPP_
+#define TDZDDEVALTUPLE_HPP_
+
+#include <cstddef>
+#include <tuple>
+
+/**
+ * 複数の評価器を1回のボトムアップの走査でまとめて評価する評価器.
+ * 評価値は各評価器の評価値の組 std::tuple である.
+ * 各評価器は const な value0(), value1(), value() を持たなければならない.
+ */
+template<typename... Eval>
+class TdZddEvalTuple {
+    template<size_t... I>
+    struct Indices {
+    };
+
+    template<size_t N, size_t... I>
+    struct MakeIndices: MakeIndices<N - 1, N - 1, I...> {
+    };
+
+    template<size_t... I>
+    struct MakeIndices<0,I...> {
+        typedef Indices<I...> Type;
+    };
+
+    typedef typename MakeIndices<sizeof...(Eval)>::Type All;
+
+    std::tuple<Eval...> evals;
+
+public:
+    typedef std::tuple<typename Eval::ValueType...> ValueType;
+
+    TdZddEvalTuple(Eval const&... evals)
+            : evals(evals...) {
+    }
+
+private:
+    template<size_t... I>
+    ValueType value0(Indices<I...>) const {
+        return ValueType(std::get<I>(evals).value0()...);
+    }
+
+    template<size_t... I>
+    ValueType value1(Indices<I...>) const {
+        return ValueType(std::get<I>(evals).value1()...);
+    }
+
+    template<size_t... I>
+    ValueType value(int k0, ValueType const& v0, int k1, ValueType const& v1,
+            int k, Indices<I...>) const {
+        return ValueType(std::get<I>(evals).value(k0, std::get<I>(v0), k1,
+                std::get<I>(v1), k)...);
+    }
+
+public:
+    ValueType value0() const {
+        return value0(All());
+    }
+
+    ValueType value1() const {
+        return value1(All());
+    }
+
+    ValueType value(int k0, ValueType const& v0, int k1, ValueType const& v1,
+            int k) const {
+        return value(k0, v0, k1, v1, k, All());
+    }
+};
+
+#endif /* TDZDDEVALTUPLE_HPP_ */
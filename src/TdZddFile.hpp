@@ -0,0 +1,229 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: TdZddFile.hpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#ifndef TDZDDFILE_HPP_
+#define TDZDDFILE_HPP_
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * ZDDのバイナリファイル形式 (全て実行環境のバイト順).
+ *   ヘッダ          TdZddFileHeader
+ *   メタデータ      metaBytes バイト
+ *   レベル表        (numVars+1) 個のノード番号
+ *   ノード配列      nodes 個の (lo, hi) の組
+ *   チェックサム    uint64_t
+ * 各区間は8バイト境界に揃え, 隙間は0で埋める.
+ * ノード番号は idBytes (4または8) バイトで, 0と1は終端ノード,
+ * レベル i のノードは番号 [offset[i+1], offset[i]) を占める.
+ * チェックサムはそれより前の全体を8バイト単位で TdZddChecksum に通した値.
+ */
+struct TdZddFileHeader {
+    char magic[8];      ///< "TDZDDBIN".
+    uint32_t version;   ///< 形式の版.
+    uint32_t idBytes;   ///< ノード番号のバイト数.
+    uint32_t byteOrder; ///< BYTE_ORDER_MARK. バイト順の確認用.
+    uint32_t reserved;
+    uint64_t numVars;   ///< 変数の数.
+    uint64_t nodes;     ///< 終端ノードを含むノード数.
+    uint64_t top;       ///< 始点のノード番号.
+    uint64_t metaBytes; ///< メタデータのバイト数.
+
+    static uint32_t const VERSION = 1;
+    static uint32_t const BYTE_ORDER_MARK = 0x01020304;
+
+    static char const* magicString() {
+        return "TDZDDBIN";
+    }
+
+    void initialize(uint32_t idBytes, uint64_t numVars, uint64_t nodes,
+            uint64_t top, uint64_t metaBytes) {
+        std::memset(this, 0, sizeof(*this));
+        std::memcpy(magic, magicString(), sizeof(magic));
+        this->version = VERSION;
+        this->idBytes = idBytes;
+        this->byteOrder = BYTE_ORDER_MARK;
+        this->numVars = numVars;
+        this->nodes = nodes;
+        this->top = top;
+        this->metaBytes = metaBytes;
+    }
+
+    static size_t align(size_t n) {
+        return (n + 7) & ~size_t(7);
+    }
+};
+
+/**
+ * 8バイト単位の FNV-1a 風チェックサム.
+ */
+class TdZddChecksum {
+    uint64_t h;
+
+public:
+    TdZddChecksum()
+            : h(14695981039346656037ULL) {
+    }
+
+    /**
+     * @param p 8バイト境界に揃ったデータ.
+     * @param n バイト数 (8の倍数).
+     */
+    void update(void const* p, size_t n) {
+        uint64_t const* w = static_cast<uint64_t const*>(p);
+        for (size_t i = 0; i < n / 8; ++i) {
+            h = (h ^ w[i]) * 1099511628211ULL;
+        }
+    }
+
+    uint64_t value() const {
+        return h;
+    }
+};
+
+/**
+ * チェックサムを計算しながらストリームに書き出す.
+ * 書き出しは8バイト単位で行う.
+ */
+class TdZddFileWriter {
+    std::ostream& os;
+    TdZddChecksum sum;
+    uint64_t pending;
+    size_t pendingBytes;
+
+public:
+    TdZddFileWriter(std::ostream& os)
+            : os(os), pending(0), pendingBytes(0) {
+    }
+
+    void write(void const* p, size_t n) {
+        char const* s = static_cast<char const*>(p);
+
+        while (pendingBytes != 0 && n != 0) {
+            reinterpret_cast<char*>(&pending)[pendingBytes++] = *s++;
+            --n;
+            if (pendingBytes == 8) flushPending();
+        }
+
+        size_t const m = n & ~size_t(7);
+        if (m != 0) {
+            if (reinterpret_cast<uintptr_t>(s) % 8 == 0) {
+                sum.update(s, m);
+            }
+            else {
+                for (size_t i = 0; i < m; i += 8) {
+                    uint64_t w;
+                    std::memcpy(&w, s + i, 8);
+                    sum.update(&w, 8);
+                }
+            }
+            os.write(s, m);
+            s += m;
+            n -= m;
+        }
+
+        while (n != 0) {
+            reinterpret_cast<char*>(&pending)[pendingBytes++] = *s++;
+            --n;
+        }
+    }
+
+    /**
+     * 8バイト境界まで0で埋める.
+     */
+    void pad() {
+        if (pendingBytes == 0) return;
+        while (pendingBytes < 8) {
+            reinterpret_cast<char*>(&pending)[pendingBytes++] = 0;
+        }
+        flushPending();
+    }
+
+    /**
+     * チェックサムを書き出して終了する.
+     */
+    void finish() {
+        pad();
+        uint64_t const v = sum.value();
+        os.write(reinterpret_cast<char const*>(&v), sizeof(v));
+        os.flush();
+        if (!os) throw std::runtime_error("TdZddFileWriter: Write error");
+    }
+
+private:
+    void flushPending() {
+        sum.update(&pending, 8);
+        os.write(reinterpret_cast<char const*>(&pending), 8);
+        pending = 0;
+        pendingBytes = 0;
+    }
+};
+
+/**
+ * 読み出し専用にメモリ写像したファイル.
+ */
+class TdZddMappedFile {
+    void* addr;
+    size_t length;
+
+    TdZddMappedFile(TdZddMappedFile const&);
+    TdZddMappedFile& operator=(TdZddMappedFile const&);
+
+public:
+    explicit TdZddMappedFile(std::string const& path)
+            : addr(0), length(0) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) fail(path);
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            fail(path);
+        }
+        length = st.st_size;
+
+        if (length != 0) {
+            addr = ::mmap(0, length, PROT_READ, MAP_SHARED, fd, 0);
+            if (addr == MAP_FAILED) {
+                addr = 0;
+                ::close(fd);
+                fail(path);
+            }
+        }
+
+        ::close(fd);
+    }
+
+    virtual ~TdZddMappedFile() {
+        if (addr != 0) ::munmap(addr, length);
+    }
+
+    char const* data() const {
+        return static_cast<char const*>(addr);
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    static void fail(std::string const& path) {
+        throw std::runtime_error(path + ": " + std::strerror(errno));
+    }
+};
+
+#endif /* TDZDDFILE_HPP_ */
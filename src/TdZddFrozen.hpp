@@ -0,0 +1,637 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: TdZddFrozen.hpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#ifndef TDZDDFROZEN_HPP_
+#define TDZDDFROZEN_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "TdZdd.hpp"
+#include "TdZddEvalTuple.hpp"
+#include "TdZddFile.hpp"
+#include "util/BigNumber.hpp"
+
+/**
+ * 読み出し専用の既約ZDD.
+ * ノードはボトムアップの番号で表し, 0と1は終端ノードとする.
+ * 各レベルのノードは番号の連続した区間を占め,
+ * 子ノードの番号の組 (lo, hi) を1本の配列に格納する.
+ * 配列は自身で確保するか, save() で書き出したファイルを写像して用いる.
+ * @param Id ノード番号の型.
+ */
+template<typename Id>
+class TdZddFrozenBase {
+public:
+    typedef Id NodeId;
+
+    struct Branch {
+        NodeId lo; ///< 0枝の行き先.
+        NodeId hi; ///< 1枝の行き先.
+    };
+
+private:
+    int numVars;                        ///< 変数の数.
+    std::vector<Branch> bodyStore;      ///< 自身で確保したノード配列.
+    std::vector<NodeId> offsetStore;    ///< 自身で確保したレベル表.
+    std::shared_ptr<TdZddMappedFile> file; ///< 写像したファイル.
+    Branch const* body;                 ///< ノード番号で引く子ノードの組.
+    size_t bodySize;                    ///< 終端ノードを含むノード数.
+    NodeId const* offset;               ///< レベル i のノードは [offset[i+1], offset[i]).
+    NodeId top;                         ///< 始点のノード番号.
+    bool useMP;                         ///< マルチスレッド処理を行うか.
+    std::string meta;                   ///< メタデータ.
+
+    void attach() {
+        body = bodyStore.data();
+        bodySize = bodyStore.size();
+        offset = offsetStore.data();
+    }
+
+public:
+    TdZddFrozenBase()
+            : numVars(0), bodyStore(2), offsetStore(1, 2), top(0),
+              useMP(false) {
+        bodyStore[0].lo = bodyStore[0].hi = 0;
+        bodyStore[1].lo = bodyStore[1].hi = 0;
+        attach();
+    }
+
+    TdZddFrozenBase(TdZddFrozenBase const& o)
+            : numVars(o.numVars), bodyStore(o.bodyStore),
+              offsetStore(o.offsetStore), file(o.file), body(o.body),
+              bodySize(o.bodySize), offset(o.offset), top(o.top),
+              useMP(o.useMP), meta(o.meta) {
+        if (!file) attach();
+    }
+
+    /*
+     * 移動では配列の領域がそのまま引き継がれるので,
+     * body と offset はそのまま有効である.
+     */
+    TdZddFrozenBase(TdZddFrozenBase&& o) = default;
+    TdZddFrozenBase& operator=(TdZddFrozenBase&& o) = default;
+
+    TdZddFrozenBase& operator=(TdZddFrozenBase const& o) {
+        numVars = o.numVars;
+        bodyStore = o.bodyStore;
+        offsetStore = o.offsetStore;
+        file = o.file;
+        body = o.body;
+        bodySize = o.bodySize;
+        offset = o.offset;
+        top = o.top;
+        useMP = o.useMP;
+        meta = o.meta;
+        if (!file) attach();
+        return *this;
+    }
+
+    /**
+     * 既約化済みのZDDから構築する.
+     * @param dd 元のZDD. ノードの一時変数を書き換える.
+     * @param consume trueなら変換の済んだレベルから元のZDDの領域を解放し,
+     *        最後に dd を変数なしのZDDに初期化する.
+     */
+    explicit TdZddFrozenBase(TdZdd& dd, bool consume = false)
+            : numVars(dd.numVars), bodyStore(), offsetStore(numVars + 1),
+              top(0), useMP(dd.useMP) {
+        dd.numberNodes();
+        if (dd.evalSize - 1 > NodeId(-1)) {
+            throw std::runtime_error("TdZddFrozen: Too many nodes");
+        }
+
+        bodyStore.resize(dd.evalSize);
+        bodyStore[0].lo = bodyStore[0].hi = 0;
+        bodyStore[1].lo = bodyStore[1].hi = 0;
+        top = dd.top->tmpId;
+
+        offsetStore[numVars] = 2;
+        for (int i = numVars - 1; i >= 0; --i) {
+            offsetStore[i] = offsetStore[i + 1] + dd.table[i].size();
+        }
+
+        // 上位のレベルから変換すれば, 変換済みのノードはもう参照されない
+        for (int i = 0; i < numVars; ++i) {
+            for (TdZddNode const* f = dd.table[i].front(); f != 0;
+                    f = f->next) {
+                Branch& b = bodyStore[f->tmpId];
+                b.lo = f->child0->tmpId;
+                b.hi = f->child1->tmpId;
+            }
+
+            if (consume) {
+                dd.table[i].clear();
+                dd.nodePool[i].clear();
+            }
+        }
+
+        if (consume) dd.initialize(0);
+        attach();
+    }
+
+    void useMultiProcessors(bool flag = true) {
+        useMP = flag;
+    }
+
+    int variables() const {
+        return numVars;
+    }
+
+    /**
+     * 非終端ノードの数.
+     */
+    size_t size() const {
+        return bodySize - 2;
+    }
+
+    NodeId getTop() const {
+        return top;
+    }
+
+    /**
+     * メタデータを得る. load() したファイルのもの, または set したもの.
+     */
+    std::string const& metadata() const {
+        return meta;
+    }
+
+    void setMetadata(std::string const& s) {
+        meta = s;
+    }
+
+    Branch const& branch(NodeId f) const {
+        return body[f];
+    }
+
+    NodeId levelBegin(int i) const {
+        return offset[i + 1];
+    }
+
+    NodeId levelEnd(int i) const {
+        return offset[i];
+    }
+
+    /**
+     * ノードの変数番号を得る. 終端ノードでは変数の数を返す.
+     */
+    int level(NodeId f) const {
+        if (f < 2) return numVars;
+        int lo = 0;
+        int hi = numVars - 1;
+        while (lo < hi) {
+            int mid = (lo + hi + 1) / 2;
+            if (offset[mid] > f) {
+                lo = mid;
+            }
+            else {
+                hi = mid - 1;
+            }
+        }
+        return lo;
+    }
+
+    /**
+     * 全ノードをボトムアップに評価する.
+     * @param eval 評価器.
+     * @param values ノード番号で引く評価値の格納先.
+     */
+    template<typename Eval>
+    void evaluate(Eval& eval,
+            std::vector<typename Eval::ValueType>& values) const {
+        evaluateInto(eval, values, false);
+    }
+
+    /**
+     * const な評価器はマルチスレッド処理が有効ならレベル毎に並列に呼ばれる.
+     */
+    template<typename Eval>
+    void evaluate(Eval const& eval,
+            std::vector<typename Eval::ValueType>& values) const {
+        evaluateInto(eval, values, useMP);
+    }
+
+    template<typename Eval>
+    typename Eval::ValueType evaluate(Eval& eval) const {
+        std::vector<typename Eval::ValueType> values;
+        evaluate(eval, values);
+        return values[top];
+    }
+
+    template<typename Eval>
+    typename Eval::ValueType evaluate(Eval const& eval) const {
+        std::vector<typename Eval::ValueType> values;
+        evaluate(eval, values);
+        return values[top];
+    }
+
+    /**
+     * 複数の評価器を1回の走査でまとめて評価する.
+     * @return 始点の評価値の組.
+     */
+    template<typename Eval1, typename Eval2, typename ... Evals>
+    std::tuple<typename Eval1::ValueType,typename Eval2::ValueType,
+            typename Evals::ValueType...> evaluate(Eval1 const& eval1,
+            Eval2 const& eval2, Evals const&... evals) const {
+        return evaluate(TdZddEvalTuple<Eval1,Eval2,Evals...>(eval1, eval2,
+                evals...));
+    }
+
+private:
+    /**
+     * ノード番号で引く変数番号の表を作る. 終端ノードでは変数の数とする.
+     */
+    std::vector<int> nodeLevels() const {
+        std::vector<int> lv(bodySize, numVars);
+        for (int i = 0; i < numVars; ++i) {
+            std::fill(lv.begin() + levelBegin(i), lv.begin() + levelEnd(i), i);
+        }
+        return lv;
+    }
+
+    /**
+     * 評価値を詰めない配列 values に全ノードを評価する.
+     * @param mp レベル内のノードを並列に評価するか.
+     */
+    template<typename Eval, typename T>
+    void evalLevels(Eval& eval, T* values, bool mp) const {
+        std::vector<int> const lv = nodeLevels();
+        values[0] = eval.value0();
+        values[1] = eval.value1();
+
+        for (int i = numVars - 1; i >= 0; --i) {
+            long const b = levelBegin(i);
+            long const e = levelEnd(i);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (mp)
+#endif
+            for (long f = b; f < e; ++f) {
+                Branch const& c = body[f];
+                values[f] = eval.value(lv[c.lo], values[c.lo], lv[c.hi],
+                        values[c.hi], i);
+            }
+        }
+    }
+
+    template<typename Eval, typename T>
+    void evaluateInto(Eval& eval, std::vector<T>& values, bool mp) const {
+        values.resize(bodySize);
+        evalLevels(eval, values.data(), mp);
+    }
+
+    /**
+     * std::vector<bool> は隣り合う要素が同じ語に詰められ,
+     * 並列に書き込めないので, 詰めない配列で評価してから写す.
+     */
+    template<typename Eval>
+    void evaluateInto(Eval& eval, std::vector<bool>& values, bool mp) const {
+        std::unique_ptr<bool[]> buf(new bool[bodySize]);
+        evalLevels(eval, buf.get(), mp);
+        values.assign(buf.get(), buf.get() + bodySize);
+    }
+
+    struct PathCounter {
+        typedef double ValueType;
+
+        ValueType value0() const {
+            return 0.0;
+        }
+
+        ValueType value1() const {
+            return 1.0;
+        }
+
+        ValueType value(int k0, ValueType v0, int k1, ValueType v1,
+                int k) const {
+            return v0 + v1;
+        }
+    };
+
+    /**
+     * 128ビット整数で経路の数を数える.
+     * @param count 始点からの経路の数の格納先.
+     * @return 桁あふれしなければtrue.
+     */
+    bool pathCount128(unsigned __int128& count) const {
+        std::vector<unsigned __int128> c(bodySize);
+        c[0] = 0;
+        c[1] = 1;
+
+        // ノード番号の昇順はボトムアップ順
+        for (size_t f = 2; f < bodySize; ++f) {
+            Branch const& b = body[f];
+            c[f] = c[b.lo] + c[b.hi];
+            if (c[f] < c[b.lo]) return false;
+        }
+
+        count = c[top];
+        return true;
+    }
+
+    /**
+     * 多倍長整数で経路の数を数える.
+     * 各ノードの値を必要な長さだけ1本の limb 配列に詰めて置き,
+     * ノード番号で引く開始位置の表で参照する.
+     */
+    BigNumber pathCountBig() const {
+        std::vector<size_t> pos(bodySize + 1);
+        std::vector<uint64_t> arena;
+        arena.reserve(bodySize * 2);
+        pos[0] = 0;
+        pos[1] = 0;
+        arena.push_back(1);
+        pos[2] = 1;
+
+        for (size_t f = 2; f < bodySize; ++f) {
+            Branch const& b = body[f];
+            size_t const n0 = pos[b.lo + 1] - pos[b.lo];
+            size_t const n1 = pos[b.hi + 1] - pos[b.hi];
+            size_t const p = arena.size();
+            arena.resize(p + std::max(n0, n1) + 1);
+            uint64_t* a = arena.data();
+            arena.resize(p + BigNumber::add(a + p, a + pos[b.lo], n0,
+                    a + pos[b.hi], n1));
+            pos[f + 1] = arena.size();
+        }
+
+        return BigNumber(arena.data() + pos[top], pos[top + 1] - pos[top]);
+    }
+
+public:
+    double pathCount() const {
+        return evaluate(PathCounter());
+    }
+
+    /**
+     * 1終端への経路の数を正確に数える.
+     * まず128ビット整数で数え, 桁あふれした時だけ多倍長整数で数え直す.
+     */
+    BigNumber exactPathCount() const {
+        unsigned __int128 count;
+        if (pathCount128(count)) return BigNumber(count);
+        return pathCountBig();
+    }
+
+    class const_iterator {
+        struct Selection {
+            NodeId node;
+            bool val;
+            bool operator==(Selection const& o) const {
+                return node == o.node && val == o.val;
+            }
+        };
+
+        TdZddFrozenBase const& dd;
+        int cursor;
+        std::vector<Selection> path;
+        std::vector<int> itemSet;
+
+    public:
+        const_iterator(TdZddFrozenBase const& dd, bool begin)
+                : dd(dd), cursor(begin ? -1 : -2), path(), itemSet() {
+            if (begin) next(dd.top);
+        }
+
+        const_iterator& operator++() {
+            next(0);
+            return *this;
+        }
+
+        std::vector<int> const& operator*() const {
+            return itemSet;
+        }
+
+        std::vector<int> const* operator->() const {
+            return &itemSet;
+        }
+
+        bool operator==(const_iterator const& o) const {
+            return cursor == o.cursor && path == o.path;
+        }
+
+        bool operator!=(const_iterator const& o) const {
+            return !operator==(o);
+        }
+
+    private:
+        void next(NodeId f) {
+            for (;;) {
+                while (f != 0) { // down
+                    if (f == 1) return;
+                    Branch const& b = dd.body[f];
+
+                    if (b.lo != 0) {
+                        cursor = path.size();
+                        Selection sel = { f, false };
+                        path.push_back(sel);
+                        f = b.lo;
+                    }
+                    else {
+                        Selection sel = { f, true };
+                        path.push_back(sel);
+                        itemSet.push_back(dd.level(f));
+                        f = b.hi;
+                    }
+                }
+
+                for (; cursor >= 0; --cursor) { // up
+                    Selection& s = path[cursor];
+                    if (s.val == false && dd.body[s.node].hi != 0) {
+                        f = s.node;
+                        s.val = true;
+                        path.resize(cursor + 1);
+                        int const k = dd.level(f);
+                        while (!itemSet.empty() && itemSet.back() >= k) {
+                            itemSet.pop_back();
+                        }
+                        itemSet.push_back(k);
+                        f = dd.body[f].hi;
+                        break;
+                    }
+                }
+
+                if (cursor < 0) { // end() state
+                    cursor = -2;
+                    path.clear();
+                    itemSet.clear();
+                    return;
+                }
+            }
+        }
+    };
+
+    const_iterator begin() const {
+        return const_iterator(*this, true);
+    }
+
+    const_iterator end() const {
+        return const_iterator(*this, false);
+    }
+
+private:
+    struct DumpLabeler {
+        int operator()(int i) {
+            return i;
+        }
+    };
+
+public:
+    void dump(std::ostream& os) const {
+        dump(os, DumpLabeler());
+    }
+
+    /**
+     * DOT形式で出力する. ノード名にはノード番号を用いる.
+     */
+    template<typename L>
+    void dump(std::ostream& os, L labeler) const {
+        os << "digraph {\n";
+
+        int j = 0;
+
+        for (int i = 0; i < numVars; ++i) {
+            if (levelBegin(i) == levelEnd(i)) continue;
+
+            for (NodeId f = levelBegin(i); f < levelEnd(i); ++f) {
+                Branch const& b = body[f];
+                os << "  \"" << f << "\" [label=\"" << labeler(i) << "\"];\n";
+                if (b.lo != 0) {
+                    os << "  \"" << f << "\" -> \"" << b.lo
+                            << "\" [style=dashed];\n";
+                    if (b.lo == 1) ++j;
+                }
+                if (b.hi != 0) {
+                    os << "  \"" << f << "\" -> \"" << b.hi
+                            << "\" [style=solid];\n";
+                    if (b.hi == 1) ++j;
+                }
+            }
+
+            os << "  {rank=same";
+            for (NodeId f = levelBegin(i); f < levelEnd(i); ++f) {
+                os << "; \"" << f << "\"";
+            }
+            os << "}\n";
+        }
+
+        if (size() == 0) {
+            os << "  \"" << top << "\" [shape=square,label=\"" << top
+                    << "\"];\n";
+        }
+        else if (j != 0) {
+            os << "  \"1\" [shape=square,label=\"1\"];\n";
+        }
+
+        os << "}\n";
+        os.flush();
+    }
+
+    /**
+     * バイナリ形式で書き出す. 形式は TdZddFile.hpp を参照.
+     * @param os 出力先.
+     */
+    void save(std::ostream& os) const {
+        TdZddFileWriter w(os);
+        TdZddFileHeader h;
+        h.initialize(sizeof(NodeId), numVars, bodySize, top, meta.size());
+
+        w.write(&h, sizeof(h));
+        w.write(meta.data(), meta.size());
+        w.pad();
+        w.write(offset, (numVars + 1) * sizeof(NodeId));
+        w.pad();
+        w.write(body, bodySize * sizeof(Branch));
+        w.finish();
+    }
+
+    /**
+     * save() で書き出したファイルを写像する. 内容の変換は行わない.
+     * 子ノードの番号が範囲内にあることは verify によらず検査する.
+     * @param path ファイル名.
+     * @param verify チェックサムを検査するか.
+     */
+    void load(std::string const& path, bool verify = true) {
+        std::shared_ptr<TdZddMappedFile> f(new TdZddMappedFile(path));
+        char const* p = f->data();
+        size_t const n = f->size();
+
+        TdZddFileHeader h;
+        if (n < sizeof(h) + 8) loadError(path, "Too short");
+        std::memcpy(&h, p, sizeof(h));
+
+        if (std::memcmp(h.magic, TdZddFileHeader::magicString(),
+                sizeof(h.magic)) != 0) loadError(path, "Not a ZDD file");
+        if (h.version != TdZddFileHeader::VERSION) {
+            loadError(path, "Unsupported version");
+        }
+        if (h.byteOrder != TdZddFileHeader::BYTE_ORDER_MARK) {
+            loadError(path, "Byte order mismatch");
+        }
+        if (h.idBytes != sizeof(NodeId)) loadError(path, "Node id size mismatch");
+
+        if (h.numVars >= n || h.nodes >= n) loadError(path, "Size mismatch");
+
+        size_t const metaPos = sizeof(h);
+        size_t const offsetPos = metaPos + TdZddFileHeader::align(h.metaBytes);
+        size_t const bodyPos = offsetPos
+                + TdZddFileHeader::align((h.numVars + 1) * sizeof(NodeId));
+        size_t const sumPos = bodyPos + h.nodes * sizeof(Branch);
+        if (h.nodes < 2 || sumPos + 8 != n) loadError(path, "Size mismatch");
+
+        if (verify) {
+            TdZddChecksum sum;
+            sum.update(p, sumPos);
+            uint64_t v;
+            std::memcpy(&v, p + sumPos, sizeof(v));
+            if (sum.value() != v) loadError(path, "Checksum mismatch");
+        }
+
+        // チェックサムを省いても, 子の番号で範囲外を読まないように
+        // 各ノードの子が自分のレベルより下にあることは確かめる.
+        NodeId const* off = reinterpret_cast<NodeId const*>(p + offsetPos);
+        Branch const* b = reinterpret_cast<Branch const*>(p + bodyPos);
+        if (off[h.numVars] != 2 || off[0] != h.nodes || h.top >= h.nodes) {
+            loadError(path, "Broken structure");
+        }
+        for (long i = long(h.numVars) - 1; i >= 0; --i) {
+            if (off[i] < off[i + 1]) loadError(path, "Broken structure");
+            for (NodeId f = off[i + 1]; f < off[i]; ++f) {
+                if (b[f].lo >= off[i + 1] || b[f].hi >= off[i + 1]) {
+                    loadError(path, "Broken structure");
+                }
+            }
+        }
+
+        numVars = h.numVars;
+        bodyStore.clear();
+        offsetStore.clear();
+        file = f;
+        body = reinterpret_cast<Branch const*>(p + bodyPos);
+        bodySize = h.nodes;
+        offset = reinterpret_cast<NodeId const*>(p + offsetPos);
+        top = h.top;
+        meta.assign(p + metaPos, h.metaBytes);
+    }
+
+private:
+    static void loadError(std::string const& path, char const* what) {
+        throw std::runtime_error(path + ": " + what);
+    }
+};
+
+typedef TdZddFrozenBase<uint32_t> TdZddFrozen;
+typedef TdZddFrozenBase<uint64_t> TdZddFrozen64;
+
+#endif /* TDZDDFROZEN_HPP_ */
@@ -8,226 +8,239 @@
 #ifndef TDZDDHASH_HPP_
 #define TDZDDHASH_HPP_
 
+#include <algorithm>
 #include <cassert>
-#include <iostream>
-#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 
-namespace {
-
-static unsigned long long const primes[] = { (1ULL << 3) + 3, (1ULL << 4) + 3,
-        (1ULL << 5) + 5, (1ULL << 6) + 3, (1ULL << 7) + 3, (1ULL << 8) + 7,
-        (1ULL << 9) + 9, (1ULL << 10) + 7, (1ULL << 11) + 5, (1ULL << 12) + 3,
-        (1ULL << 13) + 17, (1ULL << 14) + 27, (1ULL << 15) + 3, (1ULL << 16)
-                + 3, (1ULL << 17) + 29, (1ULL << 18) + 3, (1ULL << 19) + 21,
-        (1ULL << 20) + 7, (1ULL << 21) + 17, (1ULL << 22) + 15, (1ULL << 23)
-                + 9, (1ULL << 24) + 43, (1ULL << 25) + 35, (1ULL << 26) + 15,
-        (1ULL << 27) + 29, (1ULL << 28) + 3, (1ULL << 29) + 11, (1ULL << 30)
-                + 3, (1ULL << 31) + 11, (1ULL << 32) + 15, (1ULL << 33) + 17,
-        (1ULL << 34) + 25, (1ULL << 35) + 53, (1ULL << 36) + 31, (1ULL << 37)
-                + 9, (1ULL << 38) + 7, (1ULL << 39) + 23, (1ULL << 40) + 15 };
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
 
-inline size_t tableSize(size_t n) {
-    n *= 2;
+namespace {
 
-    int lo = 0;
-    int hi = sizeof(primes) / sizeof(primes[0]) - 1;
+/**
+ * ハッシュ値の全ビットを攪拌する.
+ */
+inline size_t hashMix(size_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
 
-    if (n > primes[hi]) return n + 1;
+/**
+ * バイト列のハッシュ値を求める.
+ * 8バイトずつ2系列に分けて混ぜ, 最後に hashMix() で全ビットを攪拌する.
+ * SSE4.2 を有効にしてコンパイルしたとき (Makefile の SSE) は crc32 命令で混ぜる.
+ * 端数のバイトは0で埋めた語として扱うので, 同じ内容なら同じ値になる.
+ * @param p 先頭アドレス.
+ * @param n バイト数.
+ * @param seed 初期値.
+ */
+inline size_t hashBytes(void const* p, size_t n, size_t seed) {
+    unsigned char const* s = static_cast<unsigned char const*>(p);
+    uint64_t h0 = seed;
+    uint64_t h1 = n;
+
+    for (; n >= 16; n -= 16, s += 16) {
+        uint64_t w0, w1;
+        std::memcpy(&w0, s, 8);
+        std::memcpy(&w1, s + 8, 8);
+#ifdef __SSE4_2__
+        h0 = _mm_crc32_u64(h0, w0);
+        h1 = _mm_crc32_u64(h1, w1);
+#else
+        h0 = (h0 ^ w0) * 0x9e3779b97f4a7c15ULL;
+        h1 = (h1 ^ w1) * 0xc2b2ae3d27d4eb4fULL;
+#endif
+    }
 
-    int i = (lo + hi) / 2;
-    while (lo < hi) {
-        if (n <= primes[i]) {
-            hi = i;
-        }
-        else {
-            lo = i + 1;
-        }
-        i = (lo + hi) / 2;
+    if (n > 0) {
+        uint64_t w0 = 0, w1 = 0;
+        std::memcpy(&w0, s, std::min<size_t>(n, 8));
+        if (n > 8) std::memcpy(&w1, s + 8, n - 8);
+#ifdef __SSE4_2__
+        h0 = _mm_crc32_u64(h0, w0);
+        h1 = _mm_crc32_u64(h1, w1);
+#else
+        h0 = (h0 ^ w0) * 0x9e3779b97f4a7c15ULL;
+        h1 = (h1 ^ w1) * 0xc2b2ae3d27d4eb4fULL;
+#endif
     }
 
-    assert(i == lo && i == hi);
-    return primes[i];
+    return hashMix(h0 ^ (h1 << 32 | h1 >> 32));
 }
 
+/**
+ * n 要素を格納できる2のべき乗の表サイズを返す.
+ */
+inline size_t tableSize(size_t n) {
+    size_t size = 16;
+    while (size * 7 < n * 8) {
+        size <<= 1;
+    }
+    return size;
 }
 
-template<class E> class TdZddHashSet;
-
-template<class E>
-class TdZddHashSet<E*> {
-    static int const MAX_RATIO = 90;
+}
 
+/**
+ * Robin Hood 法によるオープンアドレス法のハッシュ表.
+ * 各スロットには攪拌したハッシュ値を別の配列に持つ.
+ * 下位ビットは本来の位置を, 上位32ビットは使用中フラグと指紋を表し,
+ * 両方が一致した時だけ要素を比較する.
+ * 負荷率が 7/8 を超えると表の大きさを倍にして再配置する.
+ */
+template<class Entry>
+class TdZddHashTable {
     size_t size_;
     size_t capacity_;
-    E** table;
+    uint64_t* code;
+    Entry* table_;
     size_t items_;
-    int collisions_;
+    size_t collisions_;
+    size_t maxProbe_;
 
-    TdZddHashSet(TdZddHashSet const&);
-    TdZddHashSet& operator=(TdZddHashSet const&);
+    TdZddHashTable(TdZddHashTable const&);
+    TdZddHashTable& operator=(TdZddHashTable const&);
 
-public:
-    TdZddHashSet()
-            : size_(0), capacity_(0), table(0), items_(0), collisions_(0) {
+    static uint64_t codeOf(size_t hash) {
+        return uint64_t(hashMix(hash)) | 0x8000000000000000ULL;
     }
 
-    TdZddHashSet(size_t maxItems)
-            : size_(tableSize(maxItems)), capacity_(size_),
-              table(new E*[capacity_]), items_(0), collisions_(0) {
-        for (size_t i = 0; i < size_; ++i) {
-            table[i] = 0;
-        }
+    /**
+     * スロット k の要素の本来の位置からの距離を返す.
+     */
+    size_t distance(size_t k) const {
+        return (k - code[k]) & (size_ - 1);
     }
 
-    virtual ~TdZddHashSet() {
-        delete[] table;
-    }
-
-    void initialize(size_t maxItems) {
-        size_ = tableSize(maxItems);
-        items_ = 0;
-        collisions_ = 0;
-
-        if (size_ > capacity_) {
-            capacity_ = size_;
-            delete[] table;
-            table = new E*[capacity_];
+    /**
+     * スロット k から要素を配置し, 押し出された要素を後方へずらす.
+     */
+    void place(size_t k, size_t d, uint64_t c, Entry const& e) {
+        size_t const mask = size_ - 1;
+        Entry tmp = e;
+
+        while (code[k] != 0) {
+            size_t dd = distance(k);
+            if (dd < d) {
+                std::swap(c, code[k]);
+                std::swap(tmp, table_[k]);
+                d = dd;
+            }
+            k = (k + 1) & mask;
+            ++d;
+            if (d > maxProbe_) maxProbe_ = d;
         }
 
-        for (size_t i = 0; i < size_; ++i) {
-            table[i] = 0;
-        }
+        code[k] = c;
+        table_[k] = tmp;
     }
 
-    E* add(E* elem) {
-        if (items_ * 100 >= size_ * MAX_RATIO) {
-            std::cerr << "\nsize = " << size_ << ", items = " << items_
-                    << ", collisions = " << collisions_ << "\n";
-            throw std::runtime_error("TdZddHashSet: Table overflow");
-        }
-
-        size_t col = 0;
-        size_t i = elem->hashCode() % size_;
-        while (table[i] != 0) {
-            if (table[i]->equals(*elem)) return table[i];
-            ++col;
-            ++i;
-            if (i >= size_) i = 0;
+    void resize(size_t newSize) {
+        uint64_t* oldCode = code;
+        Entry* oldTable = table_;
+        size_t const oldSize = size_;
+
+        size_ = capacity_ = newSize;
+        code = new uint64_t[capacity_];
+        table_ = new Entry[capacity_];
+        std::memset(code, 0, size_ * sizeof(uint64_t));
+        maxProbe_ = 0;
+
+        size_t const mask = size_ - 1;
+        for (size_t k = 0; k < oldSize; ++k) {
+            if (oldCode[k] == 0) continue;
+            place(oldCode[k] & mask, 0, oldCode[k], oldTable[k]);
         }
 
-        ++items_;
-        collisions_ += col;
-        return table[i] = elem;
+        delete[] oldCode;
+        delete[] oldTable;
     }
 
-    size_t capacity() const {
-        return capacity_;
+protected:
+    TdZddHashTable()
+            : size_(0), capacity_(0), code(0), table_(0), items_(0),
+              collisions_(0), maxProbe_(0) {
     }
 
-    size_t size() const {
-        return size_;
-    }
-
-    size_t items() const {
-        return items_;
-    }
-
-    size_t collisions() const {
-        return collisions_;
+    TdZddHashTable(size_t maxItems)
+            : size_(tableSize(maxItems)), capacity_(size_),
+              code(new uint64_t[capacity_]), table_(new Entry[capacity_]),
+              items_(0), collisions_(0), maxProbe_(0) {
+        std::memset(code, 0, size_ * sizeof(uint64_t));
     }
-};
-
-template<class K, class V> class TdZddHashMap {
-    static int const MAX_RATIO = 90;
-
-public:
-    struct Entry {
-        bool used;
-        K key;
-        V value;
-    };
 
-private:
-    size_t size_;
-    size_t capacity_;
-    Entry* table;
-    size_t items_;
-    int collisions_;
-
-    size_t hashCode(K const& key) const {
-        return static_cast<size_t>(key);
-    }
+    /**
+     * 要素を検索し, 無ければ挿入する.
+     * @param hash 要素のハッシュ値.
+     * @param e 挿入する要素.
+     * @param equals 指紋が一致した要素との比較関数.
+     * @return 既存の要素または挿入した要素のスロット番号.
+     */
+    template<typename Equals>
+    size_t insert(size_t hash, Entry const& e, Equals equals) {
+        if (items_ * 8 >= size_ * 7) {
+            resize(size_ == 0 ? tableSize(0) : size_ * 2);
+        }
 
-    TdZddHashMap(TdZddHashMap const&);
-    TdZddHashMap& operator=(TdZddHashMap const&);
+        size_t const mask = size_ - 1;
+        uint64_t const c = codeOf(hash);
+        size_t k = c & mask;
+        size_t d = 0;
+
+        while (code[k] != 0 && distance(k) >= d) {
+            if (code[k] == c && equals(table_[k])) {
+                collisions_ += d;
+                return k;
+            }
+            k = (k + 1) & mask;
+            ++d;
+        }
 
-public:
-    TdZddHashMap()
-            : size_(0), capacity_(0), table(0), items_(0), collisions_(0) {
+        ++items_;
+        collisions_ += d;
+        if (d > maxProbe_) maxProbe_ = d;
+        place(k, d, c, e);
+        return k;
     }
 
-    TdZddHashMap(size_t maxItems)
-            : size_(tableSize(maxItems)), capacity_(size_),
-              table(new Entry[capacity_]), items_(0), collisions_(0) {
-        for (size_t i = 0; i < size_; ++i) {
-            table[i].used = false;
-        }
+    Entry& entry(size_t k) {
+        return table_[k];
     }
 
-    virtual ~TdZddHashMap() {
-        delete[] table;
+public:
+    virtual ~TdZddHashTable() {
+        delete[] code;
+        delete[] table_;
     }
 
+    /**
+     * 表を空にする. 必要なら領域を確保し直す.
+     * @param maxItems 予想される要素数.
+     */
     void initialize(size_t maxItems) {
         size_ = tableSize(maxItems);
         items_ = 0;
         collisions_ = 0;
+        maxProbe_ = 0;
 
         if (size_ > capacity_) {
             capacity_ = size_;
-            delete[] table;
-            table = new Entry[capacity_];
+            delete[] code;
+            delete[] table_;
+            code = new uint64_t[capacity_];
+            table_ = new Entry[capacity_];
         }
 
-        for (size_t i = 0; i < size_; ++i) {
-            table[i].used = false;
-        }
-    }
-
-    V& put(K const& key, V const& value) {
-        if (items_ * 100 >= size_ * MAX_RATIO) {
-            std::cerr << "\nsize = " << size_ << ", items = " << items_
-                    << ", collisions = " << collisions_ << "\n";
-            throw std::runtime_error("TdZddHashMap: Table overflow");
-        }
-
-        size_t col = 0;
-        size_t i = hashCode(key) % size_;
-        while (table[i].used) {
-            if (table[i].key == key) return table[i].value;
-            ++col;
-            ++i;
-            if (i >= size_) i = 0;
-        }
-
-        ++items_;
-        collisions_ += col;
-        table[i].used = true;
-        table[i].key = key;
-        table[i].value = value;
-        return table[i].value;
+        std::memset(code, 0, size_ * sizeof(uint64_t));
     }
 
-//    V const& get(K const& key) {
-//        static V const notFound;
-//        size_t i = hashCode(key) % size_;
-//        while (table[i].used) {
-//            if (table[i].key == key) return table[i].value;
-//            ++i;
-//        }
-//        return notFound;
-//    }
-
     size_t capacity() const {
         return capacity_;
     }
@@ -240,111 +253,104 @@ public:
         return items_;
     }
 
+    /**
+     * 検索と挿入で辿ったスロット数の累計を返す.
+     */
     size_t collisions() const {
         return collisions_;
     }
-};
 
-template<class K, class V>
-class TdZddHashMap<K*,V> {
-    static int const MAX_RATIO = 90;
-
-public:
-    struct Entry {
-        K* key;
-        V value;
-    };
+    /**
+     * 要素の本来の位置からの距離の最大値を返す.
+     */
+    size_t maxProbe() const {
+        return maxProbe_;
+    }
 
-private:
-    size_t size_;
-    size_t capacity_;
-    Entry* table;
-    size_t items_;
-    int collisions_;
+    /**
+     * 要素の本来の位置からの距離の平均値を返す.
+     */
+    double averageProbe() const {
+        if (items_ == 0) return 0;
+        size_t total = 0;
+        for (size_t k = 0; k < size_; ++k) {
+            if (code[k] != 0) total += distance(k);
+        }
+        return double(total) / items_;
+    }
+};
 
-    TdZddHashMap(TdZddHashMap const&);
-    TdZddHashMap& operator=(TdZddHashMap const&);
+template<class E> class TdZddHashSet;
 
+template<class E>
+class TdZddHashSet<E*> : public TdZddHashTable<E*> {
 public:
-    TdZddHashMap()
-            : size_(0), capacity_(0), table(0), items_(0), collisions_(0) {
+    TdZddHashSet() {
     }
 
-    TdZddHashMap(size_t maxItems)
-            : size_(tableSize(maxItems)), capacity_(size_),
-              table(new Entry[capacity_]), items_(0), collisions_(0) {
-        for (size_t i = 0; i < size_; ++i) {
-            table[i].key = 0;
-        }
+    TdZddHashSet(size_t maxItems)
+            : TdZddHashTable<E*>(maxItems) {
     }
 
-    virtual ~TdZddHashMap() {
-        delete[] table;
+    E* add(E* elem) {
+        size_t k = this->insert(elem->hashCode(), elem, [elem](E* const& e) {
+            return e->equals(*elem);
+        });
+        return this->entry(k);
     }
+};
 
-    void initialize(size_t maxItems) {
-        size_ = tableSize(maxItems);
-        items_ = 0;
-        collisions_ = 0;
+template<class K, class V>
+struct TdZddHashMapEntry {
+    K key;
+    V value;
+};
 
-        if (size_ > capacity_) {
-            capacity_ = size_;
-            delete[] table;
-            table = new Entry[capacity_];
-        }
+template<class K, class V>
+class TdZddHashMap: public TdZddHashTable<TdZddHashMapEntry<K,V>> {
+public:
+    typedef TdZddHashMapEntry<K,V> Entry;
 
-        for (size_t i = 0; i < size_; ++i) {
-            table[i].key = 0;
-        }
+private:
+    size_t hashCode(K const& key) const {
+        return static_cast<size_t>(key);
     }
 
-    V& put(K* key, V const& value) {
-        if (items_ * 100 >= size_ * MAX_RATIO) {
-            std::cerr << "\nsize = " << size_ << ", items = " << items_
-                    << ", collisions = " << collisions_ << "\n";
-            throw std::runtime_error("TdZddHashMap: Table overflow");
-        }
-
-        size_t col = 0;
-        size_t i = key->hashCode() % size_;
-        while (table[i].key != 0) {
-            if (table[i].key->equals(*key)) return table[i].value;
-            ++col;
-            ++i;
-            if (i >= size_) i = 0;
-        }
-
-        ++items_;
-        collisions_ += col;
-        table[i].key = key;
-        table[i].value = value;
-        return table[i].value;
+public:
+    TdZddHashMap() {
     }
 
-//    V const& get(K* key) {
-//        static V const notFound;
-//        size_t i = key->hashCode() % size_;
-//        while (table[i].key != 0) {
-//            if (table[i].key->equals(*key)) return table[i].value;
-//            ++i;
-//        }
-//        return notFound;
-//    }
+    TdZddHashMap(size_t maxItems)
+            : TdZddHashTable<Entry>(maxItems) {
+    }
 
-    size_t capacity() const {
-        return capacity_;
+    V& put(K const& key, V const& value) {
+        Entry e = {key, value};
+        size_t k = this->insert(hashCode(key), e, [&key](Entry const& x) {
+            return x.key == key;
+        });
+        return this->entry(k).value;
     }
+};
 
-    size_t size() const {
-        return size_;
+template<class K, class V>
+class TdZddHashMap<K*,V> : public TdZddHashTable<TdZddHashMapEntry<K*,V>> {
+public:
+    typedef TdZddHashMapEntry<K*,V> Entry;
+
+    TdZddHashMap() {
     }
 
-    size_t items() const {
-        return items_;
+    TdZddHashMap(size_t maxItems)
+            : TdZddHashTable<Entry>(maxItems) {
     }
 
-    size_t collisions() const {
-        return collisions_;
+    V& put(K* key, V const& value) {
+        Entry e = {key, value};
+        size_t k = this->insert(key->hashCode(), e, [key](Entry const& x) {
+            return x.key->equals(*key);
+        });
+        return this->entry(k).value;
     }
 };
 
@@ -0,0 +1,528 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: TdZddIndex.hpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#ifndef TDZDDINDEX_HPP_
+#define TDZDDINDEX_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "TdZdd.hpp"
+#include "TdZddFrozen.hpp"
+#include "util/BigNumber.hpp"
+
+/**
+ * ZDDが表す組合せ集合族への番号による参照.
+ * 組合せには TdZdd::const_iterator の順に0から番号を付ける.
+ * 構築時に各ノードから1終端への経路の数を1回だけ数えておき,
+ * 番号と組合せの変換は始点から終端までの1本の経路をたどるだけで済ませる.
+ * 経路の数はノード毎に同じ数の64ビット limb で持ち,
+ * 桁あふれしたら limb の数を倍にして数え直す.
+ */
+class TdZddIndex {
+protected:
+    struct Branch {
+        size_t lo; ///< 0枝の行き先.
+        size_t hi; ///< 1枝の行き先.
+    };
+
+    int numVars;                ///< 変数の数.
+    std::vector<Branch> body;   ///< ボトムアップの番号で引く子ノードの組.
+    std::vector<int> varIndex;  ///< ノードの変数番号.
+    size_t top;                 ///< 始点のノード番号.
+    size_t width;               ///< 1ノード当たりの limb の数.
+    std::vector<uint64_t> counts; ///< ノード番号順に並べた経路の数.
+    bool useMP;                 ///< マルチスレッド処理を行うか.
+
+    uint64_t const* count(size_t f) const {
+        return counts.data() + f * width;
+    }
+
+    /**
+     * 固定長の limb 列の加算.
+     * @return 桁あふれしなければtrue.
+     */
+    static bool add(uint64_t* dst, uint64_t const* a, uint64_t const* b,
+            size_t n) {
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t const s = a[i] + b[i];
+            uint64_t const t = s + carry;
+            carry = (s < a[i]) | (t < s);
+            dst[i] = t;
+        }
+        return carry == 0;
+    }
+
+    static void subtract(uint64_t* a, uint64_t const* b, size_t n) {
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t const s = a[i] - b[i];
+            uint64_t const t = s - borrow;
+            borrow = (a[i] < b[i]) | (s < borrow);
+            a[i] = t;
+        }
+    }
+
+    static bool less(uint64_t const* a, uint64_t const* b, size_t n) {
+        for (size_t i = n; i > 0; --i) {
+            if (a[i - 1] != b[i - 1]) return a[i - 1] < b[i - 1];
+        }
+        return false;
+    }
+
+    /**
+     * 番号を width 個の limb に詰める.
+     * @return 番号が組合せの総数未満ならtrue.
+     */
+    bool toLimbs(BigNumber const& k, std::vector<uint64_t>& r) const {
+        if (k.limbs() > width) return false;
+        r.assign(width, 0);
+        std::copy(k.data(), k.data() + k.limbs(), r.begin());
+        return less(r.data(), count(top), width);
+    }
+
+    /**
+     * 1ノード当たり width 個の limb で経路の数を数える.
+     * @return 桁あふれしなければtrue.
+     */
+    bool countPaths() {
+        counts.assign(body.size() * width, 0);
+        counts[width] = 1;
+
+        // ノード番号の昇順はボトムアップ順
+        for (size_t f = 2; f < body.size(); ++f) {
+            Branch const& b = body[f];
+            if (!add(&counts[f * width], count(b.lo), count(b.hi), width)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * r 番目の組合せへの経路をたどる.
+     * 0枝側の組合せが1枝側の組合せより先に並ぶ.
+     * @param r 組合せの総数未満の番号. 作業領域として書き換える.
+     * @param visitor 経路上の非終端ノード毎に (ノード番号, 選んだ枝) で呼ぶ.
+     */
+    template<typename Visitor>
+    void walk(uint64_t* r, Visitor& visitor) const {
+        size_t f = top;
+
+        while (f >= 2) {
+            Branch const& b = body[f];
+            uint64_t const* c0 = count(b.lo);
+            if (less(r, c0, width)) {
+                visitor(f, false);
+                f = b.lo;
+            }
+            else {
+                subtract(r, c0, width);
+                visitor(f, true);
+                f = b.hi;
+            }
+        }
+    }
+
+    struct ItemCollector {
+        TdZddIndex const& index;
+        std::vector<int>& items;
+
+        void operator()(size_t f, bool val) {
+            if (val) items.push_back(index.varIndex[f]);
+        }
+    };
+
+    /**
+     * r 番目の組合せを求める.
+     * @param r 組合せの総数未満の番号. 作業領域として書き換える.
+     * @param items 組合せの格納先. 変数番号の昇順に並べる.
+     */
+    void select(uint64_t* r, std::vector<int>& items) const {
+        items.clear();
+        ItemCollector collector = { *this, items };
+        walk(r, collector);
+    }
+
+public:
+    /**
+     * ZDDから番号の表を作る. 以後 dd を書き換えても影響を受けない.
+     * @param dd 元のZDD. ノードの一時変数を書き換える.
+     */
+    explicit TdZddIndex(TdZdd& dd)
+            : numVars(dd.numVars), top(0), width(1), useMP(dd.useMP) {
+        dd.numberNodes();
+        body.resize(dd.evalSize);
+        varIndex.resize(dd.evalSize, numVars);
+        body[0].lo = body[0].hi = 0;
+        body[1].lo = body[1].hi = 0;
+        top = dd.top->tmpId;
+
+        for (int i = 0; i < numVars; ++i) {
+            for (TdZddNode const* f = dd.table[i].front(); f != 0;
+                    f = f->next) {
+                Branch& b = body[f->tmpId];
+                b.lo = f->child0->tmpId;
+                b.hi = f->child1->tmpId;
+                varIndex[f->tmpId] = i;
+            }
+        }
+
+        while (!countPaths()) {
+            width *= 2;
+        }
+    }
+
+    /**
+     * 読み出し専用のZDDから番号の表を作る.
+     * @param zdd 元のZDD.
+     */
+    template<typename Id>
+    explicit TdZddIndex(TdZddFrozenBase<Id> const& zdd)
+            : numVars(zdd.variables()), body(zdd.size() + 2),
+              varIndex(zdd.size() + 2, numVars), top(zdd.getTop()),
+              width(1), useMP(false) {
+        body[0].lo = body[0].hi = 0;
+        body[1].lo = body[1].hi = 0;
+
+        for (int i = 0; i < numVars; ++i) {
+            for (Id f = zdd.levelBegin(i); f < zdd.levelEnd(i); ++f) {
+                body[f].lo = zdd.branch(f).lo;
+                body[f].hi = zdd.branch(f).hi;
+                varIndex[f] = i;
+            }
+        }
+
+        while (!countPaths()) {
+            width *= 2;
+        }
+    }
+
+    void useMultiProcessors(bool flag = true) {
+        useMP = flag;
+    }
+
+    /**
+     * 並列処理に用いるスレッド数.
+     */
+    int threads() const {
+#ifdef _OPENMP
+        if (useMP) return omp_get_max_threads();
+#endif
+        return 1;
+    }
+
+    int variables() const {
+        return numVars;
+    }
+
+    /**
+     * 組合せの総数.
+     */
+    BigNumber size() const {
+        return BigNumber(count(top), width);
+    }
+
+    bool empty() const {
+        uint64_t const* total = count(top);
+        for (size_t i = 0; i < width; ++i) {
+            if (total[i] != 0) return false;
+        }
+        return true;
+    }
+
+    /**
+     * k 番目の組合せを求める.
+     * @param k 番号.
+     * @param items 組合せの格納先. 変数番号の昇順に並べる.
+     * @return k が組合せの総数未満ならtrue.
+     */
+    bool unrank(BigNumber const& k, std::vector<int>& items) const {
+        std::vector<uint64_t> r;
+        if (!toLimbs(k, r)) return false;
+        select(r.data(), items);
+        return true;
+    }
+
+    bool unrank(uint64_t k, std::vector<int>& items) const {
+        return unrank(BigNumber(k), items);
+    }
+
+    /**
+     * 組合せの番号を求める.
+     * @param items 変数番号の昇順に並べた組合せ.
+     * @param k 番号の格納先.
+     * @return 組合せが族に含まれればtrue.
+     */
+    bool rank(std::vector<int> const& items, BigNumber& k) const {
+        std::vector<uint64_t> r(width);
+        size_t f = top;
+        size_t j = 0;
+
+        while (f >= 2) {
+            Branch const& b = body[f];
+            if (j < items.size() && items[j] == varIndex[f]) {
+                add(r.data(), r.data(), count(b.lo), width);
+                f = b.hi;
+                ++j;
+            }
+            else if (j < items.size() && items[j] < varIndex[f]) {
+                return false;
+            }
+            else {
+                f = b.lo;
+            }
+        }
+
+        if (f != 1 || j != items.size()) return false;
+        k = BigNumber(r.data(), r.size());
+        return true;
+    }
+
+    /**
+     * 番号の連続した組合せを順にたどる反復子.
+     * 終端までの経路を持ち, TdZdd::const_iterator と同じ方法で進める.
+     */
+    class const_iterator {
+        struct Selection {
+            size_t node;
+            bool val;
+            bool operator==(Selection const& o) const {
+                return node == o.node && val == o.val;
+            }
+        };
+
+        TdZddIndex const& index;
+        int cursor;
+        std::vector<Selection> path;
+        std::vector<int> itemSet;
+
+        struct PathBuilder {
+            const_iterator& it;
+
+            void operator()(size_t f, bool val) {
+                if (!val) it.cursor = it.path.size();
+                Selection sel = { f, val };
+                it.path.push_back(sel);
+                if (val) it.itemSet.push_back(it.index.varIndex[f]);
+            }
+        };
+
+    public:
+        /**
+         * k 番目の組合せを指す反復子を作る. k が総数以上なら end() になる.
+         */
+        const_iterator(TdZddIndex const& index, BigNumber const& k)
+                : index(index), cursor(-2), path(), itemSet() {
+            std::vector<uint64_t> r;
+            if (!index.toLimbs(k, r)) return;
+            cursor = -1;
+            PathBuilder builder = { *this };
+            index.walk(r.data(), builder);
+        }
+
+        const_iterator& operator++() {
+            next(0);
+            return *this;
+        }
+
+        std::vector<int> const& operator*() const {
+            return itemSet;
+        }
+
+        std::vector<int> const* operator->() const {
+            return &itemSet;
+        }
+
+        bool operator==(const_iterator const& o) const {
+            return cursor == o.cursor && path == o.path;
+        }
+
+        bool operator!=(const_iterator const& o) const {
+            return !operator==(o);
+        }
+
+    private:
+        void next(size_t f) {
+            std::vector<Branch> const& body = index.body;
+
+            for (;;) {
+                while (f != 0) { // down
+                    if (f == 1) return;
+
+                    if (body[f].lo != 0) {
+                        cursor = path.size();
+                        Selection sel = { f, false };
+                        path.push_back(sel);
+                        f = body[f].lo;
+                    }
+                    else {
+                        Selection sel = { f, true };
+                        path.push_back(sel);
+                        itemSet.push_back(index.varIndex[f]);
+                        f = body[f].hi;
+                    }
+                }
+
+                for (; cursor >= 0; --cursor) { // up
+                    Selection& s = path[cursor];
+                    if (s.val == false && body[s.node].hi != 0) {
+                        f = s.node;
+                        s.val = true;
+                        path.resize(cursor + 1);
+                        int const k = index.varIndex[f];
+                        while (!itemSet.empty() && itemSet.back() >= k) {
+                            itemSet.pop_back();
+                        }
+                        itemSet.push_back(k);
+                        f = body[f].hi;
+                        break;
+                    }
+                }
+
+                if (cursor < 0) { // end() state
+                    cursor = -2;
+                    path.clear();
+                    itemSet.clear();
+                    return;
+                }
+            }
+        }
+    };
+
+    const_iterator begin() const {
+        return const_iterator(*this, BigNumber());
+    }
+
+    const_iterator end() const {
+        return const_iterator(*this, size());
+    }
+
+    /**
+     * k 番目の組合せを指す反復子. 位置決めは経路の長さに比例する時間で済む.
+     */
+    const_iterator find(BigNumber const& k) const {
+        return const_iterator(*this, k);
+    }
+
+    /**
+     * 番号が [k, k+m) の組合せを順に求める.
+     * @param k 先頭の番号.
+     * @param m 求める数の上限.
+     * @param sets 組合せの列の格納先. 総数を超える分は含めない.
+     */
+    void range(BigNumber const& k, size_t m,
+            std::vector<std::vector<int>>& sets) const {
+        sets.clear();
+        const_iterator const e = end();
+        for (const_iterator p = find(k); sets.size() < m && p != e; ++p) {
+            sets.push_back(*p);
+        }
+    }
+
+    /**
+     * 全ての組合せを出力する.
+     * マルチスレッド処理が有効で総数が64ビットに収まるなら,
+     * 番号を一定の数ずつの区間に分けてスレッドに割り当て,
+     * 各スレッドは区間の分を自身のバッファに書いてから os にまとめて書き出す.
+     * @param os 出力先.
+     * @param printer (std::string&, 組合せ) で呼ぶ出力関数.
+     *        文字列の末尾に組合せの表現を追加する. スレッド毎に複製して使う.
+     * @param ordered trueなら反復子の順に, falseなら区間の終わった順に書き出す.
+     */
+    template<typename Printer>
+    void print(std::ostream& os, Printer const& printer,
+            bool ordered = true) const {
+        const_iterator const e = end();
+        int const nt = threads();
+
+        // 総数が64ビットに収まらなければ区間の番号を64ビットで表せないので,
+        // 1スレッドで順に出力する.
+        uint64_t const* total = count(top);
+        bool const small = std::all_of(total + 1, total + width,
+                [](uint64_t x) {return x == 0;});
+
+        if (nt == 1 || !small) {
+            Printer pr(printer);
+            std::string buf;
+            for (const_iterator p = begin(); p != e; ++p) {
+                pr(buf, *p);
+                if (buf.size() >= (1 << 20)) {
+                    os.write(buf.data(), buf.size());
+                    buf.clear();
+                }
+            }
+            os.write(buf.data(), buf.size());
+            return;
+        }
+
+        // 区間は1スレッド当たり8個以上にし, 大きくても CHUNK_SIZE 個までとする.
+        // 区間の数が MAX_CHUNKS を超えるなら最後の区間を終わりまで延ばす.
+        uint64_t const CHUNK_SIZE = 4096;
+        uint64_t const MAX_CHUNKS = INT64_MAX / CHUNK_SIZE;
+        uint64_t const chunk = std::max<uint64_t>(1,
+                std::min<uint64_t>(CHUNK_SIZE, total[0] / (nt * 8)));
+        uint64_t const n = std::min(MAX_CHUNKS,
+                total[0] / chunk + (total[0] % chunk != 0));
+        long const m = n;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            Printer pr(printer);
+            std::string buf;
+
+            // j 番目の区間の出力を buf に作る.
+            auto format = [&](long j) {
+                buf.clear();
+                bool const last = (j == m - 1);
+                const_iterator p = find(BigNumber(uint64_t(j) * chunk));
+                for (uint64_t k = 0; (last || k < chunk) && p != e; ++k, ++p) {
+                    pr(buf, *p);
+                }
+            };
+
+            // ordered 節付きのループは ordered 領域を必ず通らなければならないので,
+            // 順序を問わない場合は別のループにする.
+            if (ordered) {
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic) ordered
+#endif
+                for (long j = 0; j < m; ++j) {
+                    format(j);
+#ifdef _OPENMP
+#pragma omp ordered
+#endif
+                    os.write(buf.data(), buf.size());
+                }
+            }
+            else {
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+                for (long j = 0; j < m; ++j) {
+                    format(j);
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+                    os.write(buf.data(), buf.size());
+                }
+            }
+        }
+    }
+};
+
+#endif /* TDZDDINDEX_HPP_ */
@@ -192,6 +192,19 @@ public:
         return p;
     }
 
+    /**
+     * 連結済みの要素列をリストの内容とする.
+     * @param front 先頭要素 (空なら0).
+     * @param back 末尾要素. back->next は0であること.
+     * @param size 要素数.
+     */
+    void assign(Element* front, Element* back, size_t size) {
+        assert(front == 0 || back->next == 0);
+        front_ = front;
+        end_ = (front_ == 0) ? iterator(front_) : iterator(back->next);
+        size_ = size;
+    }
+
     void clear() {
         front_ = 0;
         end_ = iterator(front_);
@@ -0,0 +1,121 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: TdZddMemory.hpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#ifndef TDZDDMEMORY_HPP_
+#define TDZDDMEMORY_HPP_
+
+#include "TdZddPool.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+/**
+ * TdZdd のプールの使用量.
+ * レベル毎に, 確定したノード (node), 処理待ちの新ノード (newNode),
+ * 処理待ちの状態とノードリスト (workData) の3種類に分けて集計する.
+ * ハッシュ表などプール以外の作業領域は含まない.
+ */
+struct TdZddMemoryUsage {
+    struct Level {
+        TdZddPoolUsage node;
+        TdZddPoolUsage newNode;
+        TdZddPoolUsage workData;
+
+        TdZddPoolUsage total() const {
+            TdZddPoolUsage u = node;
+            u += newNode;
+            u += workData;
+            return u;
+        }
+    };
+
+    std::vector<Level> levels; ///< レベル毎の使用量.
+    size_t cached;      ///< プール間で共有する空きブロックのバイト数. 使用量とは別に数える.
+    int level;          ///< 次に処理するレベル. subset() の外では -1.
+    size_t projected;   ///< 次のレベルを処理した後の予測値. subset() の外では0.
+    size_t budget;      ///< 上限. 0 なら制限なし.
+
+    TdZddMemoryUsage()
+            : cached(0), level(-1), projected(0), budget(0) {
+    }
+
+    TdZddPoolUsage node() const {
+        TdZddPoolUsage u;
+        for (size_t i = 0; i < levels.size(); ++i) {
+            u += levels[i].node;
+        }
+        return u;
+    }
+
+    TdZddPoolUsage newNode() const {
+        TdZddPoolUsage u;
+        for (size_t i = 0; i < levels.size(); ++i) {
+            u += levels[i].newNode;
+        }
+        return u;
+    }
+
+    TdZddPoolUsage workData() const {
+        TdZddPoolUsage u;
+        for (size_t i = 0; i < levels.size(); ++i) {
+            u += levels[i].workData;
+        }
+        return u;
+    }
+
+    TdZddPoolUsage total() const {
+        TdZddPoolUsage u = node();
+        u += newNode();
+        u += workData();
+        return u;
+    }
+
+    /**
+     * プールが保持している全バイト数. キャッシュした空きブロックは含まない.
+     */
+    size_t reserved() const {
+        return total().reserved;
+    }
+
+    /**
+     * 実メモリの使用量の見積もり.
+     * ブロックの未使用部分のページは触れるまで実メモリを消費しないので,
+     * 割り当てたバイト数とする. キャッシュした空きブロックは含まない.
+     */
+    size_t resident() const {
+        return total().used;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os,
+            TdZddMemoryUsage const& o) {
+        int const mb = 1 << 20;
+        std::ios::fmtflags const flags = os.flags();
+        std::streamsize const precision = os.precision();
+        os << std::fixed << std::setprecision(1);
+        if (o.level >= 0) os << "level " << o.level << ": ";
+        os << "resident " << double(o.resident()) / mb << "MB, reserved "
+                << double(o.reserved()) / mb << "MB";
+        if (o.projected > 0) {
+            os << ", projected " << double(o.projected) / mb << "MB";
+        }
+        if (o.budget > 0) os << ", budget " << double(o.budget) / mb << "MB";
+        char const* names[] = { "node", "newNode", "workData" };
+        TdZddPoolUsage const kinds[] = { o.node(), o.newNode(), o.workData() };
+        for (int k = 0; k < 3; ++k) {
+            os << "\n  " << names[k] << ": " << double(kinds[k].used) / mb
+                    << "/" << double(kinds[k].reserved) / mb << "MB ("
+                    << kinds[k].fragmentation() * 100 << "% unused)";
+        }
+        os << "\n  cached: " << double(o.cached) / mb << "MB";
+        os.flags(flags);
+        os.precision(precision);
+        return os;
+    }
+};
+
+#endif /* TDZDDMEMORY_HPP_ */
@@ -19,6 +19,8 @@ typedef TdZddList<TdZddNode> TdZddNodeList;
  */
 class TdZddNode {
     friend class TdZdd;
+    template<typename Id> friend class TdZddFrozenBase;
+    friend class TdZddIndex;
     friend class TdZddList<TdZddNode>;
 
     TdZddNode* next;            ///< リスト構造における次の要素へのポインタ.
@@ -42,6 +44,7 @@ class TdZddNode {
     union {
         TdZddNode* tmpNodePtr;  ///< ノードポインタ保持用の一時変数.
         void* tmpPtr;           ///< ポインタ保持用の一時変数.
+        size_t tmpId;           ///< ノード番号保持用の一時変数.
         bool tmpBool;           ///< bool保持用の一時変数.
         int tmpInt;             ///< int保持用の一時変数.
         double tmpDbl;          ///< double保持用の一時変数.
@@ -119,11 +122,6 @@ public:
         return f->child1;
     }
 
-    template<typename T>
-    inline T& tmp() {
-        return *reinterpret_cast<T*>(tmpPtr);
-    }
-
     size_t hashCode() const {
         return reinterpret_cast<size_t>(child0) * 31
                 + reinterpret_cast<size_t>(child1);
@@ -141,19 +139,4 @@ public:
     }
 };
 
-template<>
-inline bool& TdZddNode::tmp<bool>() {
-    return tmpBool;
-}
-
-template<>
-inline int& TdZddNode::tmp<int>() {
-    return tmpInt;
-}
-
-template<>
-inline double& TdZddNode::tmp<double>() {
-    return tmpDbl;
-}
-
 #endif /* TDZDDNODE_HPP_ */
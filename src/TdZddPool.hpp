@@ -8,33 +8,174 @@
 #ifndef TDZDDPOOL_HPP_
 #define TDZDDPOOL_HPP_
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstring>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
+#include <type_traits>
+
+#if defined(__unix__)
+#include <sys/mman.h>
+#endif
+
+/**
+ * メモリプールの使用量.
+ */
+struct TdZddPoolUsage {
+    size_t reserved;    ///< 確保したブロックのバイト数.
+    size_t used;        ///< 要素に割り当てたバイト数.
+
+    TdZddPoolUsage()
+            : reserved(0), used(0) {
+    }
+
+    TdZddPoolUsage& operator+=(TdZddPoolUsage const& o) {
+        reserved += o.reserved;
+        used += o.used;
+        return *this;
+    }
+
+    /**
+     * 確保したが割り当てていない領域の割合 (断片化率) を返す.
+     */
+    double fragmentation() const {
+        return reserved == 0 ? 0 : double(reserved - used) / reserved;
+    }
+};
 
 /**
  * メモリプールの実装.
  * オブジェクトの消滅とともにプールしたメモリを解放する.
+ * 標準の大きさのブロックは解放時にプロセス全体のキャッシュに戻し,
+ * 他のプールが再利用する. キャッシュの上限を超えた分だけ実際に解放する.
+ * configure() でブロックの大きさと, mmap と MADV_HUGEPAGE による確保を選べる.
  */
 class TdZddPool {
-    struct Unit {
-        Unit* next;
+    union Unit {
+        Unit* next;     // 次のブロック (ブロックの先頭)
+        size_t size;    // ブロックの単位数と確保方法 (ブロックの2番目)
     };
 
     static size_t const UNIT_SIZE = sizeof(Unit);
-    static size_t const BLOCK_UNITS = 1000000 / UNIT_SIZE;
-    static size_t const MAX_ELEMENT_UNIS = BLOCK_UNITS / 10;
+    static size_t const HEADER_UNITS = 2;
+    static size_t const MAPPED = ~(~size_t(0) >> 1);
+
+    /**
+     * プロセス全体の設定と空きブロックのキャッシュ.
+     */
+    struct Cache {
+        std::mutex mutex;
+        Unit* freeList;
+        size_t freeBlocks;
+        size_t limitBytes;
+        std::atomic<size_t> blockUnits;
+        bool hugePage;
+
+        Cache()
+                : freeList(0), freeBlocks(0), limitBytes(size_t(256) << 20),
+                  blockUnits(1000000 / UNIT_SIZE), hugePage(false) {
+        }
+    };
+
+    /**
+     * 静的なプールの消滅時にも使えるよう, キャッシュ自体は破棄しない.
+     */
+    static Cache& cache() {
+        static Cache* c = new Cache();
+        return *c;
+    }
 
     Unit* blockList;
     size_t nextUnit;
+    size_t limitUnit;
+    size_t reservedUnits;
+    size_t usedUnits;
+
+    static Unit* newBlock(size_t units, bool hugePage) {
+        Unit* block = 0;
+#if defined(__unix__) && defined(MAP_ANONYMOUS)
+        if (hugePage) {
+            void* p = ::mmap(0, units * UNIT_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+                ::madvise(p, units * UNIT_SIZE, MADV_HUGEPAGE);
+#endif
+                block = static_cast<Unit*>(p);
+                block[1].size = units | MAPPED;
+            }
+        }
+#endif
+        if (block == 0) {
+            block = new Unit[units];
+            block[1].size = units;
+        }
+        return block;
+    }
+
+    static void freeBlock(Unit* block) {
+        size_t const units = block[1].size & ~MAPPED;
+#if defined(__unix__) && defined(MAP_ANONYMOUS)
+        if (block[1].size & MAPPED) {
+            ::munmap(block, units * UNIT_SIZE);
+            return;
+        }
+#endif
+        delete[] block;
+    }
+
+    /**
+     * 標準の大きさのブロックをキャッシュから取り出すか新たに確保する.
+     */
+    static Unit* acquireBlock() {
+        Cache& c = cache();
+        size_t units;
+        bool hugePage;
+        {
+            std::lock_guard<std::mutex> lock(c.mutex);
+            if (c.freeList != 0) {
+                Unit* block = c.freeList;
+                c.freeList = block->next;
+                --c.freeBlocks;
+                return block;
+            }
+            units = c.blockUnits;
+            hugePage = c.hugePage;
+        }
+        return newBlock(units, hugePage);
+    }
+
+    /**
+     * ブロックを手放す. 標準の大きさならキャッシュの上限まで保持する.
+     */
+    static void releaseBlock(Unit* block) {
+        Cache& c = cache();
+        {
+            std::lock_guard<std::mutex> lock(c.mutex);
+            size_t const units = block[1].size & ~MAPPED;
+            if (units == c.blockUnits
+                    && (c.freeBlocks + 1) * units * UNIT_SIZE <= c.limitBytes) {
+                block->next = c.freeList;
+                c.freeList = block;
+                ++c.freeBlocks;
+                return;
+            }
+        }
+        freeBlock(block);
+    }
 
 public:
     TdZddPool()
-            : blockList(0), nextUnit(BLOCK_UNITS) {
+            : blockList(0), nextUnit(0), limitUnit(0), reservedUnits(0),
+              usedUnits(0) {
     }
 
     TdZddPool(TdZddPool const& o)
-            : blockList(0), nextUnit(BLOCK_UNITS) {
+            : blockList(0), nextUnit(0), limitUnit(0), reservedUnits(0),
+              usedUnits(0) {
         if (o.blockList != 0) throw std::runtime_error(
                 "Can't copy non-empty object");
     }
@@ -54,9 +195,10 @@ public:
         while (blockList != 0) {
             Unit* block = blockList;
             blockList = blockList->next;
-            delete[] block;
+            releaseBlock(block);
         }
-        nextUnit = BLOCK_UNITS;
+        nextUnit = limitUnit = 0;
+        reservedUnits = usedUnits = 0;
     }
 
     void splice(TdZddPool& o) {
@@ -70,18 +212,124 @@ public:
 
         blockList = o.blockList;
         nextUnit = o.nextUnit;
+        limitUnit = o.limitUnit;
+        reservedUnits += o.reservedUnits;
+        usedUnits += o.usedUnits;
 
         o.blockList = 0;
-        o.nextUnit = BLOCK_UNITS;
+        o.nextUnit = o.limitUnit = 0;
+        o.reservedUnits = o.usedUnits = 0;
+    }
+
+    /**
+     * このプールが持つブロックと割り当てた領域の大きさを返す.
+     * ブロックのヘッダは割り当てていない領域に数える.
+     */
+    TdZddPoolUsage usage() const {
+        TdZddPoolUsage u;
+        u.reserved = reservedUnits * UNIT_SIZE;
+        u.used = usedUnits * UNIT_SIZE;
+        return u;
+    }
+
+    /**
+     * 以後に確保するブロックの大きさと確保方法を設定し, キャッシュを空にする.
+     * 既存のブロックは大きさが変われば解放時にキャッシュせずに返す.
+     * @param blockBytes ブロックのバイト数.
+     * @param hugePage mmap で確保して MADV_HUGEPAGE を指定するか.
+     *                 この場合ブロックは2MBの倍数に切り上げる.
+     */
+    static void configure(size_t blockBytes, bool hugePage) {
+        if (hugePage) {
+            size_t const h = size_t(2) << 20;
+            blockBytes = (blockBytes + h - 1) / h * h;
+        }
+        size_t const units = std::max<size_t>(blockBytes / UNIT_SIZE,
+                HEADER_UNITS * 16);
+        releaseCache();
+        Cache& c = cache();
+        std::lock_guard<std::mutex> lock(c.mutex);
+        c.blockUnits = units;
+        c.hugePage = hugePage;
+    }
+
+    /**
+     * キャッシュに保持する空きブロックの総量の上限を設定する.
+     * @param bytes 上限のバイト数. 0 ならキャッシュしない.
+     */
+    static void setCacheLimit(size_t bytes) {
+        {
+            Cache& c = cache();
+            std::lock_guard<std::mutex> lock(c.mutex);
+            c.limitBytes = bytes;
+        }
+        trimCache(bytes);
+    }
+
+    /**
+     * キャッシュに保持する空きブロックの総量の上限を返す.
+     */
+    static size_t cacheLimit() {
+        Cache& c = cache();
+        std::lock_guard<std::mutex> lock(c.mutex);
+        return c.limitBytes;
+    }
+
+    /**
+     * キャッシュした空きブロックが bytes 以下になるまで解放する.
+     * 上限は変えない.
+     * @param bytes 残すバイト数.
+     */
+    static void trimCache(size_t bytes) {
+        Cache& c = cache();
+        std::lock_guard<std::mutex> lock(c.mutex);
+        while (c.freeList != 0
+                && c.freeBlocks * c.blockUnits * UNIT_SIZE > bytes) {
+            Unit* block = c.freeList;
+            c.freeList = block->next;
+            --c.freeBlocks;
+            freeBlock(block);
+        }
+    }
+
+    /**
+     * キャッシュした空きブロックを全て解放する.
+     */
+    static void releaseCache() {
+        Cache& c = cache();
+        std::lock_guard<std::mutex> lock(c.mutex);
+        while (c.freeList != 0) {
+            Unit* block = c.freeList;
+            c.freeList = block->next;
+            freeBlock(block);
+        }
+        c.freeBlocks = 0;
+    }
+
+    /**
+     * キャッシュした空きブロックのバイト数を返す.
+     */
+    static size_t cachedBytes() {
+        Cache& c = cache();
+        std::lock_guard<std::mutex> lock(c.mutex);
+        return c.freeBlocks * c.blockUnits * UNIT_SIZE;
+    }
+
+    /**
+     * 標準のブロックのバイト数を返す.
+     */
+    static size_t blockSize() {
+        Cache& c = cache();
+        std::lock_guard<std::mutex> lock(c.mutex);
+        return c.blockUnits * UNIT_SIZE;
     }
 
 private:
     void* allocate_(size_t n) {
         size_t const elementUnits = (n + UNIT_SIZE - 1) / UNIT_SIZE;
 
-        if (elementUnits > MAX_ELEMENT_UNIS) {
-            size_t m = elementUnits + 1;
-            Unit* block = new Unit[m];
+        if (elementUnits > cache().blockUnits.load(std::memory_order_relaxed) / 10) {
+            Unit* block = newBlock(elementUnits + HEADER_UNITS, false);
             if (blockList == 0) {
                 block->next = 0;
                 blockList = block;
@@ -90,19 +338,24 @@ private:
                 block->next = blockList->next;
                 blockList->next = block;
             }
-            return block + 1;
+            reservedUnits += elementUnits + HEADER_UNITS;
+            usedUnits += elementUnits;
+            return block + HEADER_UNITS;
         }
 
-        if (nextUnit + elementUnits > BLOCK_UNITS) {
-            Unit* block = new Unit[BLOCK_UNITS];
+        if (nextUnit + elementUnits > limitUnit) {
+            Unit* block = acquireBlock();
             block->next = blockList;
             blockList = block;
-            nextUnit = 1;
-            assert(nextUnit + elementUnits <= BLOCK_UNITS);
+            nextUnit = HEADER_UNITS;
+            limitUnit = block[1].size & ~MAPPED;
+            reservedUnits += limitUnit;
+            assert(nextUnit + elementUnits <= limitUnit);
         }
 
         Unit* p = blockList + nextUnit;
         nextUnit += elementUnits;
+        usedUnits += elementUnits;
         return p;
     }
 
@@ -152,4 +405,53 @@ public:
     }
 };
 
+/**
+ * フィルタの状態をプールに複製し, 不要になったら消滅させる.
+ * 状態が static bool const podState = true を宣言していれば,
+ * 状態はバイト列として複製でき, 消滅の処理も要らないものとみなす.
+ * この場合は複製コンストラクタとデストラクタを呼ばず, memcpy で複製する.
+ * 複製した状態のバイト列は複製元と同じになるので,
+ * podState を宣言する状態は trivially copyable でなければならず,
+ * プールの外の資源を持ってはならない.
+ */
+template<typename S>
+class TdZddStateCopy {
+    template<typename T>
+    static std::integral_constant<bool,T::podState> test(int);
+
+    template<typename T>
+    static std::false_type test(...);
+
+    typedef decltype(test<S>(0)) Pod;
+
+    static_assert(!Pod::value || std::is_trivially_copyable<S>::value,
+            "TdZddStateCopy: podState requires a trivially copyable state");
+
+    static S* copy(S const& s, TdZddPool& pool, std::true_type) {
+        return static_cast<S*>(std::memcpy(pool.allocate<S>(), &s, sizeof(S)));
+    }
+
+    static S* copy(S const& s, TdZddPool& pool, std::false_type) {
+        return new (pool.allocate<S>()) S(s, pool);
+    }
+
+    static void destroy(S* s, std::true_type) {
+    }
+
+    static void destroy(S* s, std::false_type) {
+        s->~S();
+    }
+
+public:
+    static bool const pod = Pod::value;
+
+    static S* copy(S const& s, TdZddPool& pool) {
+        return copy(s, pool, Pod());
+    }
+
+    static void destroy(S* s) {
+        destroy(s, Pod());
+    }
+};
+
 #endif /* TDZDDPOOL_HPP_ */
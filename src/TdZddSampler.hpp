@@ -0,0 +1,102 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: TdZddSampler.hpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#ifndef TDZDDSAMPLER_HPP_
+#define TDZDDSAMPLER_HPP_
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "TdZdd.hpp"
+#include "TdZddIndex.hpp"
+
+/**
+ * ZDDが表す組合せ集合族からの一様な無作為抽出.
+ * TdZddIndex の番号を一様に選び, 1回の抽出は1本の経路をたどるだけで済ませる.
+ * 乱数は種を指定できる std::mt19937_64 で, 同じ種なら同じ列を返す.
+ */
+class TdZddSampler: public TdZddIndex {
+    std::mt19937_64 rng;        ///< 乱数生成器.
+    std::vector<uint64_t> work; ///< 抽出時の作業領域.
+
+    /**
+     * 一様な乱数を work に作る. 値は経路の総数未満.
+     * 総数の最上位ビットまでの乱数を作り, 総数以上なら作り直す.
+     */
+    void randomIndex() {
+        uint64_t const* total = count(top);
+        size_t n = width;
+        while (n > 1 && total[n - 1] == 0) {
+            --n;
+        }
+        uint64_t mask = total[n - 1];
+        for (int k = 1; k < 64; k <<= 1) {
+            mask |= mask >> k;
+        }
+
+        work.assign(width, 0);
+        do {
+            for (size_t i = 0; i < n; ++i) {
+                work[i] = rng();
+            }
+            work[n - 1] &= mask;
+        } while (!less(work.data(), total, n));
+    }
+
+public:
+    /**
+     * ZDDから抽出器を作る. 以後 dd を書き換えても影響を受けない.
+     * @param dd 元のZDD. ノードの一時変数を書き換える.
+     * @param seed 乱数の種.
+     */
+    explicit TdZddSampler(TdZdd& dd,
+            uint64_t seed = std::mt19937_64::default_seed)
+            : TdZddIndex(dd), rng(seed) {
+    }
+
+    /**
+     * 乱数の種を設定し直す.
+     */
+    void seed(uint64_t s) {
+        rng.seed(s);
+    }
+
+    /**
+     * 組合せを1つ一様に選ぶ. 空の族では空集合を返す.
+     * @param items 組合せの格納先. 変数番号の昇順に並べる.
+     */
+    void sample(std::vector<int>& items) {
+        if (empty()) {
+            items.clear();
+            return;
+        }
+        randomIndex();
+        select(work.data(), items);
+    }
+
+    std::vector<int> sample() {
+        std::vector<int> items;
+        sample(items);
+        return items;
+    }
+
+    /**
+     * 組合せを k 個, 互いに独立に一様に選ぶ.
+     * @param k 選ぶ数.
+     * @return 選んだ組合せの列.
+     */
+    std::vector<std::vector<int>> sample(size_t k) {
+        std::vector<std::vector<int>> v(k);
+        for (size_t j = 0; j < k; ++j) {
+            sample(v[j]);
+        }
+        return v;
+    }
+};
+
+#endif /* TDZDDSAMPLER_HPP_ */
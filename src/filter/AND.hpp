@@ -8,33 +8,81 @@
 #ifndef AND_HPP_
 #define AND_HPP_
 
+#include <iostream>
+
 #include "TdZddPool.hpp"
 
-template<typename F1, typename F2>
-class AND {
+/**
+ * AND の状態のうちフィルタを持つ部分.
+ * 最初の状態はフィルタの配列を置くプールを自身で持つ.
+ */
+template<typename F1, typename F2,
+        bool pod = TdZddStateCopy<F1>::pod && TdZddStateCopy<F2>::pod>
+class ANDState {
     TdZddPool* pool;
-    int const numVars;
+
+    ANDState(ANDState const&);
+    ANDState& operator=(ANDState const&);
+
+protected:
+    int numVars;
     F1 filter1;
     F2 filter2;
 
-    AND(AND const&);
-    AND& operator=(AND const&);
-
-public:
-    AND(int numVars, F1 const& filter1, F2 const& filter2)
+    ANDState(int numVars, F1 const& filter1, F2 const& filter2)
             : pool(new TdZddPool()), numVars(numVars), filter1(filter1, *pool),
               filter2(filter2, *pool) {
     }
 
-    AND(AND const& o, TdZddPool& pool)
+    ANDState(ANDState const& o, TdZddPool& pool)
             : pool(0), numVars(o.numVars), filter1(o.filter1, pool),
               filter2(o.filter2, pool) {
     }
 
-    virtual ~AND() {
+    ~ANDState() {
         delete pool;
         pool = 0;
     }
+};
+
+/**
+ * 両方のフィルタの状態がバイト列として複製できる場合.
+ * プールを持たず, 自身もバイト列として複製できる.
+ */
+template<typename F1, typename F2>
+class ANDState<F1,F2,true> {
+protected:
+    int numVars;
+    F1 filter1;
+    F2 filter2;
+
+    ANDState(int numVars, F1 const& filter1, F2 const& filter2)
+            : numVars(numVars), filter1(filter1), filter2(filter2) {
+    }
+
+    ANDState(ANDState const& o, TdZddPool& pool)
+            : numVars(o.numVars), filter1(o.filter1), filter2(o.filter2) {
+    }
+};
+
+template<typename F1, typename F2>
+class AND: public ANDState<F1,F2> {
+    typedef ANDState<F1,F2> Base;
+    using Base::numVars;
+    using Base::filter1;
+    using Base::filter2;
+
+public:
+    static bool const podState = TdZddStateCopy<F1>::pod
+            && TdZddStateCopy<F2>::pod;
+
+    AND(int numVars, F1 const& filter1, F2 const& filter2)
+            : Base(numVars, filter1, filter2) {
+    }
+
+    AND(AND const& o, TdZddPool& pool)
+            : Base(o, pool) {
+    }
 
     size_t hashCode() const {
         return filter1.hashCode() * 31 + filter2.hashCode();
@@ -44,6 +92,16 @@ public:
         return filter1.equals(o.filter1) && filter2.equals(o.filter2);
     }
 
+    void save(std::ostream& os) const {
+        filter1.save(os);
+        filter2.save(os);
+    }
+
+    void load(std::istream& is) {
+        filter1.load(is);
+        filter2.load(is);
+    }
+
     int down(bool take, int fromIndex, int toIndex) {
         int v1 = filter1.down(take, fromIndex, toIndex);
         if (v1 == 0) return 0;
@@ -12,23 +12,28 @@
 
 #include "TdZddPool.hpp"
 #include "graph/Graph.hpp"
-#include "util/ShiftedArray.hpp"
+#include "util/PackedArray.hpp"
 
-class Degree0or2 {
+/**
+ * 各頂点の次数を0か2 (端点は1) に制限するフィルタ.
+ * @tparam W 状態の配列の物理サイズ. 0 ならフロンティアの幅から実行時に決める.
+ *           正なら各頂点の次数を2ビットに詰めて持つ.
+ */
+template<int W = 0>
+class BasicDegree0or2 {
     typedef short DegreeCount;
 
-    Graph const& graph;
-    ShiftedArray<DegreeCount> dc;
-
-    Degree0or2(Degree0or2 const&);
-    Degree0or2& operator=(Degree0or2 const&);
+    Graph const* graph;
+    typename StateArray<DegreeCount,W,2>::Type dc;
 
 public:
-    Degree0or2(Graph const& graph)
-            : graph(graph), dc(graph.maxFrontierSize(), 1, 0) {
+    static bool const podState = W > 0;
+
+    BasicDegree0or2(Graph const& graph)
+            : graph(&graph), dc(graph.maxFrontierSize(), 1, 0) {
     }
 
-    Degree0or2(Degree0or2 const& o, TdZddPool& pool)
+    BasicDegree0or2(BasicDegree0or2 const& o, TdZddPool& pool)
             : graph(o.graph), dc(o.dc, pool) {
     }
 
@@ -36,15 +41,25 @@ public:
         return dc.hashCode();
     }
 
-    bool equals(Degree0or2 const& o) const {
+    bool equals(BasicDegree0or2 const& o) const {
         return dc.equals(o.dc);
     }
 
+    void save(std::ostream& os) const {
+        dc.save(os);
+    }
+
+    void load(std::istream& is) {
+        dc.load(is);
+    }
+
     int down(bool take, int fromIndex, int toIndex);
 
-    friend std::ostream& operator<<(std::ostream& os, Degree0or2 const& o) {
+    friend std::ostream& operator<<(std::ostream& os, BasicDegree0or2 const& o) {
         return os << o.dc;
     }
 };
 
+typedef BasicDegree0or2<> Degree0or2;
+
 #endif /* DEGREE0OR2_HPP_ */
@@ -9,14 +9,15 @@
 
 #include <cassert>
 
-int Degree2::down(bool take, int fromIndex, int toIndex) {
+template<int W>
+int BasicDegree2<W>::down(bool take, int fromIndex, int toIndex) {
     Graph::ArcNumber arc = fromIndex;
     Graph::ArcNumber nextArc = toIndex;
     assert(arc < nextArc);
-    assert(nextArc <= graph.arcSize());
+    assert(nextArc <= graph->arcSize());
 
     for (; arc < nextArc; ++arc) {
-        Graph::VertexNumberPair const vp = graph.vertexPair(arc);
+        Graph::VertexNumberPair const vp = graph->vertexPair(arc);
         Graph::VertexNumber const v1 = vp.first;
         Graph::VertexNumber const v2 = vp.second;
         assert(v1 <= v2);
@@ -29,7 +30,7 @@ int Degree2::down(bool take, int fromIndex, int toIndex) {
                 dc.setMaxIndex(v2);
                 while (vmax < v2) {
                     ++vmax;
-                    dc[vmax] = graph.isTerminal(vmax) ? 1 : 0;
+                    dc[vmax] = graph->isTerminal(vmax) ? 1 : 0;
                 }
             }
 
@@ -39,7 +40,7 @@ int Degree2::down(bool take, int fromIndex, int toIndex) {
             take = false;
         }
 
-        if (arc == graph.theLastArc(v1)) {
+        if (arc == graph->theLastArc(v1)) {
             if (v1 <= vmax) {
                 if (dc[v1] != 2) return 0;
             }
@@ -48,7 +49,7 @@ int Degree2::down(bool take, int fromIndex, int toIndex) {
             }
         }
 
-        if (arc == graph.theLastArc(v2)) {
+        if (arc == graph->theLastArc(v2)) {
             if (v2 <= vmax) {
                 if (dc[v2] != 2) return 0;
             }
@@ -58,9 +59,15 @@ int Degree2::down(bool take, int fromIndex, int toIndex) {
         }
     }
 
-    if (arc < graph.arcSize()) {
-        dc.setMinIndex(graph.vertexPair(arc).first);
+    if (arc < graph->arcSize()) {
+        dc.setMinIndex(graph->vertexPair(arc).first);
     }
 
     return toIndex;
 }
+
+template class BasicDegree2<0>;
+template class BasicDegree2<8>;
+template class BasicDegree2<16>;
+template class BasicDegree2<24>;
+template class BasicDegree2<32>;
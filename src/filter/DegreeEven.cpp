@@ -9,14 +9,15 @@
 
 #include <cassert>
 
-int DegreeEven::down(bool take, int fromIndex, int toIndex) {
+template<int W>
+int BasicDegreeEven<W>::down(bool take, int fromIndex, int toIndex) {
     Graph::ArcNumber arc = fromIndex;
     Graph::ArcNumber nextArc = toIndex;
     assert(arc < nextArc);
-    assert(nextArc <= graph.arcSize());
+    assert(nextArc <= graph->arcSize());
 
     for (; arc < nextArc; ++arc) {
-        Graph::VertexNumberPair const vp = graph.vertexPair(arc);
+        Graph::VertexNumberPair const vp = graph->vertexPair(arc);
         Graph::VertexNumber const v1 = vp.first;
         Graph::VertexNumber const v2 = vp.second;
         assert(v1 <= v2);
@@ -29,7 +30,7 @@ int DegreeEven::down(bool take, int fromIndex, int toIndex) {
                 dc.setMaxIndex(v2);
                 while (vmax < v2) {
                     ++vmax;
-                    dc[vmax] = graph.isTerminal(vmax) ? 1 : 0;
+                    dc[vmax] = graph->isTerminal(vmax) ? 1 : 0;
                 }
             }
 
@@ -39,28 +40,34 @@ int DegreeEven::down(bool take, int fromIndex, int toIndex) {
             take = false;
         }
 
-        if (arc == graph.theLastArc(v1)) {
+        if (arc == graph->theLastArc(v1)) {
             if (v1 <= vmax) {
                 if (dc[v1] % 2 == 1) return 0;
             }
             else {
-                if (graph.isTerminal(v1)) return 0;
+                if (graph->isTerminal(v1)) return 0;
             }
         }
 
-        if (arc == graph.theLastArc(v2)) {
+        if (arc == graph->theLastArc(v2)) {
             if (v2 <= vmax) {
                 if (dc[v2] % 2 == 1) return 0;
             }
             else {
-                if (graph.isTerminal(v2)) return 0;
+                if (graph->isTerminal(v2)) return 0;
             }
         }
     }
 
-    if (arc < graph.arcSize()) {
-        dc.setMinIndex(graph.vertexPair(arc).first);
+    if (arc < graph->arcSize()) {
+        dc.setMinIndex(graph->vertexPair(arc).first);
     }
 
     return toIndex;
 }
+
+template class BasicDegreeEven<0>;
+template class BasicDegreeEven<8>;
+template class BasicDegreeEven<16>;
+template class BasicDegreeEven<24>;
+template class BasicDegreeEven<32>;
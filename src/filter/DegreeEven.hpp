@@ -12,23 +12,28 @@
 
 #include "TdZddPool.hpp"
 #include "graph/Graph.hpp"
-#include "util/ShiftedArray.hpp"
+#include "util/PackedArray.hpp"
 
-class DegreeEven {
+/**
+ * 各頂点の次数を偶数に制限するフィルタ.
+ * @tparam W 状態の配列の物理サイズ. 0 ならフロンティアの幅から実行時に決める.
+ *           正なら各頂点の次数を16を法として4ビットに詰めて持つ (偶奇は保たれる).
+ */
+template<int W = 0>
+class BasicDegreeEven {
     typedef short DegreeCount;
 
-    Graph const& graph;
-    ShiftedArray<DegreeCount> dc;
-
-    DegreeEven(DegreeEven const&);
-    DegreeEven& operator=(DegreeEven const&);
+    Graph const* graph;
+    typename StateArray<DegreeCount,W,4>::Type dc;
 
 public:
-    DegreeEven(Graph const& graph)
-            : graph(graph), dc(graph.maxFrontierSize(), 1, 0) {
+    static bool const podState = W > 0;
+
+    BasicDegreeEven(Graph const& graph)
+            : graph(&graph), dc(graph.maxFrontierSize(), 1, 0) {
     }
 
-    DegreeEven(DegreeEven const& o, TdZddPool& pool)
+    BasicDegreeEven(BasicDegreeEven const& o, TdZddPool& pool)
             : graph(o.graph), dc(o.dc, pool) {
     }
 
@@ -36,15 +41,25 @@ public:
         return dc.hashCode();
     }
 
-    bool equals(DegreeEven const& o) const {
+    bool equals(BasicDegreeEven const& o) const {
         return dc.equals(o.dc);
     }
 
+    void save(std::ostream& os) const {
+        dc.save(os);
+    }
+
+    void load(std::istream& is) {
+        dc.load(is);
+    }
+
     int down(bool take, int fromIndex, int toIndex);
 
-    friend std::ostream& operator<<(std::ostream& os, DegreeEven const& o) {
+    friend std::ostream& operator<<(std::ostream& os, BasicDegreeEven const& o) {
         return os << o.dc;
     }
 };
 
+typedef BasicDegreeEven<> DegreeEven;
+
 #endif /* DEGREEEVEN_HPP_ */
@@ -0,0 +1,30 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: NumOfPaths.hpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#ifndef NUMOFPATHS_HPP_
+#define NUMOFPATHS_HPP_
+
+/**
+ * 1終端への経路の数を倍精度浮動小数点数で数える評価器.
+ */
+struct NumOfPaths {
+    typedef double ValueType;
+
+    double value0() const {
+        return 0.0;
+    }
+
+    double value1() const {
+        return 1.0;
+    }
+
+    double value(int k0, double v0, int k1, double v1, int k) const {
+        return v0 + v1;
+    }
+};
+
+#endif /* NUMOFPATHS_HPP_ */
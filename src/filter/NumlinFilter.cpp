@@ -9,19 +9,20 @@
 
 #include <cassert>
 
-int NumlinFilter::down(bool take, int fromIndex, int toIndex) {
+template<int W, int B>
+int BasicNumlinFilter<W,B>::down(bool take, int fromIndex, int toIndex) {
     Graph::ArcNumber arc = fromIndex;
     Graph::ArcNumber nextArc = toIndex;
     assert(arc < nextArc);
-    assert(nextArc <= graph.arcSize());
+    assert(nextArc <= graph->arcSize());
 
     for (; arc < nextArc; ++arc) {
-        auto const vp = graph.vertexPair(arc);
+        auto const vp = graph->vertexPair(arc);
         auto const v1 = vp.first;
         auto const v2 = vp.second;
         assert(v1 <= v2);
-        bool const terminal1 = graph.isTerminal(v1);
-        bool const terminal2 = graph.isTerminal(v2);
+        bool const terminal1 = graph->isTerminal(v1);
+        bool const terminal2 = graph->isTerminal(v2);
 
         mate.setMinIndex(v1);
         Graph::VertexNumber vmax = mate.maxIndex();
@@ -35,8 +36,8 @@ int NumlinFilter::down(bool take, int fromIndex, int toIndex) {
                 vmax = v2;
             }
 
-            auto const w1 = mate[v1];
-            auto const w2 = mate[v2];
+            Graph::VertexNumber const w1 = mate[v1];
+            Graph::VertexNumber const w2 = mate[v2];
             assert(w1 <= vmax);
             assert(w2 <= vmax);
 
@@ -49,16 +50,16 @@ int NumlinFilter::down(bool take, int fromIndex, int toIndex) {
                 return 0;
             }
 
-            int const n1 = graph.pathNumber(w1);
-            int const n2 = graph.pathNumber(w2);
+            int const n1 = graph->pathNumber(w1);
+            int const n2 = graph->pathNumber(w2);
             if (n1 != 0 && n2 != 0) {
                 if (n1 != n2) return 0;
 
                 if (--pathCount == 0) {
                     for (auto v = v1 + 1; v <= vmax; ++v) {
                         if (v == v2) continue;
-                        auto const w = mate[v];
-                        if (graph.isTerminal(v)) {
+                        Graph::VertexNumber const w = mate[v];
+                        if (graph->isTerminal(v)) {
                             if (w == v) return 0;
                         }
                         else {
@@ -77,9 +78,9 @@ int NumlinFilter::down(bool take, int fromIndex, int toIndex) {
             take = false;
         }
 
-        if (arc == graph.theLastArc(v1)) {
+        if (arc == graph->theLastArc(v1)) {
             if (v1 <= vmax) {
-                auto const w1 = mate[v1];
+                Graph::VertexNumber const w1 = mate[v1];
                 if (terminal1) {
                     if (w1 == v1) return 0;
                 }
@@ -92,9 +93,9 @@ int NumlinFilter::down(bool take, int fromIndex, int toIndex) {
             }
         }
 
-        if (arc == graph.theLastArc(v2)) {
+        if (arc == graph->theLastArc(v2)) {
             if (v2 <= vmax) {
-                auto const w2 = mate[v2];
+                Graph::VertexNumber const w2 = mate[v2];
                 if (terminal2) {
                     if (w2 == v2) return 0;
                 }
@@ -108,25 +109,26 @@ int NumlinFilter::down(bool take, int fromIndex, int toIndex) {
         }
     }
 
-    if (arc < graph.arcSize()) {
-        mate.setMinIndex(graph.vertexPair(arc).first);
+    if (arc < graph->arcSize()) {
+        mate.setMinIndex(graph->vertexPair(arc).first);
     }
     return toIndex;
 }
 
-int NumlinFilter2::down(bool take, int fromIndex, int toIndex) {
+template<int W, int B>
+int BasicNumlinFilter2<W,B>::down(bool take, int fromIndex, int toIndex) {
     Graph::ArcNumber arc = fromIndex;
     Graph::ArcNumber nextArc = toIndex;
     assert(arc < nextArc);
-    assert(nextArc <= graph.arcSize());
+    assert(nextArc <= graph->arcSize());
 
     for (; arc < nextArc; ++arc) {
-        auto const vp = graph.vertexPair(arc);
+        auto const vp = graph->vertexPair(arc);
         auto const v1 = vp.first;
         auto const v2 = vp.second;
         assert(v1 <= v2);
-        bool const terminal1 = graph.isTerminal(v1);
-        bool const terminal2 = graph.isTerminal(v2);
+        bool const terminal1 = graph->isTerminal(v1);
+        bool const terminal2 = graph->isTerminal(v2);
 
         mate.setMinIndex(v1);
         Graph::VertexNumber vmax = mate.maxIndex();
@@ -140,8 +142,8 @@ int NumlinFilter2::down(bool take, int fromIndex, int toIndex) {
                 vmax = v2;
             }
 
-            auto const w1 = mate[v1];
-            auto const w2 = mate[v2];
+            Graph::VertexNumber const w1 = mate[v1];
+            Graph::VertexNumber const w2 = mate[v2];
             assert(w1 <= vmax);
             assert(w2 <= vmax);
 
@@ -154,17 +156,17 @@ int NumlinFilter2::down(bool take, int fromIndex, int toIndex) {
                 return 0;
             }
 
-            int const n1 = graph.pathNumber(w1);
-            int const n2 = graph.pathNumber(w2);
+            int const n1 = graph->pathNumber(w1);
+            int const n2 = graph->pathNumber(w2);
             if (n1 != 0 && n2 != 0) {
                 if (n1 != n2) return 0;
 
                 if (--pathCount == 0) {
-                    if (vmax < graph.vertexSize() - 1) return 0; // all cells must be used
+                    if (vmax < graph->vertexSize() - 1) return 0; // all cells must be used
                     for (auto v = v1 + 1; v <= vmax; ++v) {
                         if (v == v2) continue;
-                        auto const w = mate[v];
-                        if (graph.isTerminal(v)) {
+                        Graph::VertexNumber const w = mate[v];
+                        if (graph->isTerminal(v)) {
                             if (w == v) return 0;
                         }
                         else {
@@ -183,9 +185,9 @@ int NumlinFilter2::down(bool take, int fromIndex, int toIndex) {
             take = false;
         }
 
-        if (arc == graph.theLastArc(v1)) {
+        if (arc == graph->theLastArc(v1)) {
             if (v1 <= vmax) {
-                auto const w1 = mate[v1];
+                Graph::VertexNumber const w1 = mate[v1];
                 if (terminal1) {
                     if (w1 == v1) return 0;
                 }
@@ -198,9 +200,9 @@ int NumlinFilter2::down(bool take, int fromIndex, int toIndex) {
             }
         }
 
-        if (arc == graph.theLastArc(v2)) {
+        if (arc == graph->theLastArc(v2)) {
             if (v2 <= vmax) {
-                auto const w2 = mate[v2];
+                Graph::VertexNumber const w2 = mate[v2];
                 if (terminal2) {
                     if (w2 == v2) return 0;
                 }
@@ -214,8 +216,30 @@ int NumlinFilter2::down(bool take, int fromIndex, int toIndex) {
         }
     }
 
-    if (arc < graph.arcSize()) {
-        mate.setMinIndex(graph.vertexPair(arc).first);
+    if (arc < graph->arcSize()) {
+        mate.setMinIndex(graph->vertexPair(arc).first);
     }
     return toIndex;
 }
+
+template class BasicNumlinFilter<0,8>;
+template class BasicNumlinFilter<8,8>;
+template class BasicNumlinFilter<16,8>;
+template class BasicNumlinFilter<24,8>;
+template class BasicNumlinFilter<32,8>;
+
+template class BasicNumlinFilter<8,16>;
+template class BasicNumlinFilter<16,16>;
+template class BasicNumlinFilter<24,16>;
+template class BasicNumlinFilter<32,16>;
+
+template class BasicNumlinFilter2<0,8>;
+template class BasicNumlinFilter2<8,8>;
+template class BasicNumlinFilter2<16,8>;
+template class BasicNumlinFilter2<24,8>;
+template class BasicNumlinFilter2<32,8>;
+
+template class BasicNumlinFilter2<8,16>;
+template class BasicNumlinFilter2<16,16>;
+template class BasicNumlinFilter2<24,16>;
+template class BasicNumlinFilter2<32,16>;
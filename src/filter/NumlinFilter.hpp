@@ -9,26 +9,37 @@
 #define NUMLINFILTER_HPP_
 
 #include <iostream>
+#include <stdexcept>
 
 #include "TdZddPool.hpp"
 #include "graph/Graph.hpp"
-#include "util/ShiftedArray.hpp"
+#include "util/PackedArray.hpp"
 
-class NumlinFilter {
-    Graph const& graph;
+/**
+ * 同じ数字の端点どうしを結ぶ線だけを残すフィルタ.
+ * @tparam W 状態の配列の物理サイズ. 0 ならフロンティアの幅から実行時に決める.
+ * @tparam B W が正のとき mate を相対位置で詰めるビット数.
+ *           頂点数は 2^(B-1) 以下であること.
+ */
+template<int W = 0, int B = 8>
+class BasicNumlinFilter {
+    Graph const* graph;
     Graph::PathNumber pathCount;
-    ShiftedArray<Graph::VertexNumber> mate;
-
-    NumlinFilter(NumlinFilter const&);
-    NumlinFilter& operator=(NumlinFilter const&);
+    typename StateArray<Graph::VertexNumber,W,B,true>::Type mate;
 
 public:
-    NumlinFilter(Graph const& graph)
-            : graph(graph), pathCount(graph.numPath()),
+    static bool const podState = W > 0;
+
+    BasicNumlinFilter(Graph const& graph)
+            : graph(&graph), pathCount(graph.numPath()),
               mate(graph.maxFrontierSize(), 1, 0) {
+        if (W > 0 && graph.vertexSize() > (1 << (B - 1))) {
+            throw std::runtime_error(
+                    "NumlinFilter: Too many vertices for packed mates");
+        }
     }
 
-    NumlinFilter(NumlinFilter const& o, TdZddPool& pool)
+    BasicNumlinFilter(BasicNumlinFilter const& o, TdZddPool& pool)
             : graph(o.graph), pathCount(o.pathCount), mate(o.mate, pool) {
     }
 
@@ -36,28 +47,51 @@ public:
         return mate.hashCode();
     }
 
-    bool equals(NumlinFilter const& o) const {
+    bool equals(BasicNumlinFilter const& o) const {
         return mate.equals(o.mate);
     }
 
+    void save(std::ostream& os) const {
+        os.write(reinterpret_cast<char const*>(&pathCount),
+                sizeof(pathCount));
+        mate.save(os);
+    }
+
+    void load(std::istream& is) {
+        is.read(reinterpret_cast<char*>(&pathCount), sizeof(pathCount));
+        mate.load(is);
+    }
+
     int down(bool take, int fromIndex, int toIndex);
 };
 
-class NumlinFilter2 {
-    Graph const& graph;
-    Graph::PathNumber pathCount;
-    ShiftedArray<Graph::VertexNumber> mate;
+typedef BasicNumlinFilter<> NumlinFilter;
 
-    NumlinFilter2(NumlinFilter2 const&);
-    NumlinFilter2& operator=(NumlinFilter2 const&);
+/**
+ * NumlinFilter に, 全てのマスを使う条件を加えたもの.
+ * @tparam W 状態の配列の物理サイズ. 0 ならフロンティアの幅から実行時に決める.
+ * @tparam B W が正のとき mate を相対位置で詰めるビット数.
+ *           頂点数は 2^(B-1) 以下であること.
+ */
+template<int W = 0, int B = 8>
+class BasicNumlinFilter2 {
+    Graph const* graph;
+    Graph::PathNumber pathCount;
+    typename StateArray<Graph::VertexNumber,W,B,true>::Type mate;
 
 public:
-    NumlinFilter2(Graph const& graph)
-            : graph(graph), pathCount(graph.numPath()),
+    static bool const podState = W > 0;
+
+    BasicNumlinFilter2(Graph const& graph)
+            : graph(&graph), pathCount(graph.numPath()),
               mate(graph.maxFrontierSize(), 1, 0) {
+        if (W > 0 && graph.vertexSize() > (1 << (B - 1))) {
+            throw std::runtime_error(
+                    "NumlinFilter2: Too many vertices for packed mates");
+        }
     }
 
-    NumlinFilter2(NumlinFilter2 const& o, TdZddPool& pool)
+    BasicNumlinFilter2(BasicNumlinFilter2 const& o, TdZddPool& pool)
             : graph(o.graph), pathCount(o.pathCount), mate(o.mate, pool) {
     }
 
@@ -65,11 +99,24 @@ public:
         return mate.hashCode();
     }
 
-    bool equals(NumlinFilter2 const& o) const {
+    bool equals(BasicNumlinFilter2 const& o) const {
         return mate.equals(o.mate);
     }
 
+    void save(std::ostream& os) const {
+        os.write(reinterpret_cast<char const*>(&pathCount),
+                sizeof(pathCount));
+        mate.save(os);
+    }
+
+    void load(std::istream& is) {
+        is.read(reinterpret_cast<char*>(&pathCount), sizeof(pathCount));
+        mate.load(is);
+    }
+
     int down(bool take, int fromIndex, int toIndex);
 };
 
+typedef BasicNumlinFilter2<> NumlinFilter2;
+
 #endif /* NUMLINFILTER_HPP_ */
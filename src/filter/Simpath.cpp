@@ -9,14 +9,15 @@
 
 #include <cassert>
 
-int Simpath::down(bool take, int fromIndex, int toIndex) {
+template<int W>
+int BasicSimpath<W>::down(bool take, int fromIndex, int toIndex) {
     Graph::ArcNumber arc = fromIndex;
     Graph::ArcNumber nextArc = toIndex;
     assert(arc < nextArc);
-    assert(nextArc <= graph.arcSize());
+    assert(nextArc <= graph->arcSize());
 
     for (; arc < nextArc; ++arc) {
-        Graph::VertexNumberPair const vp = graph.vertexPair(arc);
+        Graph::VertexNumberPair const vp = graph->vertexPair(arc);
         Graph::VertexNumber const v1 = vp.first;
         Graph::VertexNumber const v2 = vp.second;
         assert(v1 <= v2);
@@ -28,7 +29,7 @@ int Simpath::down(bool take, int fromIndex, int toIndex) {
             if (vmax < v2) {
                 mate.setMaxIndex(v2);
                 for (Graph::VertexNumber v = vmax + 1; v <= v2; ++v) {
-                    Graph::VertexNumber w = graph.initialMate(v);
+                    Graph::VertexNumber w = graph->initialMate(v);
                     if (w <= vmax) { // implies w != v (v is the terminal)
                         // find the current mate of v
                         for (Graph::VertexNumber x = v1; x <= vmax; ++x) {
@@ -66,21 +67,27 @@ int Simpath::down(bool take, int fromIndex, int toIndex) {
             take = false;
         }
 
-        if (arc == graph.theLastArc(v1)) {
+        if (arc == graph->theLastArc(v1)) {
             Graph::VertexNumber const w1 =
-                    (v1 <= vmax) ? mate[v1] : graph.initialMate(v1);
+                    (v1 <= vmax) ? mate[v1] : graph->initialMate(v1);
             if (w1 != 0 && w1 != v1) return 0;
         }
 
-        if (arc == graph.theLastArc(v2)) {
+        if (arc == graph->theLastArc(v2)) {
             Graph::VertexNumber const w2 =
-                    (v2 <= vmax) ? mate[v2] : graph.initialMate(v2);
+                    (v2 <= vmax) ? mate[v2] : graph->initialMate(v2);
             if (w2 != 0 && w2 != v2) return 0;
         }
     }
 
-    if (arc < graph.arcSize()) {
-        mate.setMinIndex(graph.vertexPair(arc).first);
+    if (arc < graph->arcSize()) {
+        mate.setMinIndex(graph->vertexPair(arc).first);
     }
     return toIndex;
 }
+
+template class BasicSimpath<0>;
+template class BasicSimpath<8>;
+template class BasicSimpath<16>;
+template class BasicSimpath<24>;
+template class BasicSimpath<32>;
@@ -9,24 +9,39 @@
 #define SIMPATH_HPP_
 
 #include <iostream>
+#include <stdexcept>
 
 #include "TdZddPool.hpp"
 #include "graph/Graph.hpp"
-#include "util/ShiftedArray.hpp"
+#include "util/PackedArray.hpp"
 
-class Simpath {
-    Graph const& graph;
-    ShiftedArray<Graph::VertexNumber> mate;
+/**
+ * 端点の組を結ぶ単純な道 (端点がなければ単一の閉路) だけを残すフィルタ.
+ * @tparam W 状態の配列の物理サイズ. 0 ならフロンティアの幅から実行時に決める.
+ *           正なら mate を相対位置で8ビットに詰めて持つ.
+ *           端点のあるグラフでは頂点数が128以下であること.
+ */
+template<int W = 0>
+class BasicSimpath {
+public:
+    typedef typename StateArray<Graph::VertexNumber,W,8,true>::Type MateArray;
 
-    Simpath(Simpath const&);
-    Simpath& operator=(Simpath const&);
+private:
+    Graph const* graph;
+    MateArray mate;
 
 public:
-    Simpath(Graph const& graph)
-            : graph(graph), mate(graph.maxFrontierSize(), 1, 0) {
+    static bool const podState = W > 0;
+
+    BasicSimpath(Graph const& graph)
+            : graph(&graph), mate(graph.maxFrontierSize(), 1, 0) {
+        if (W > 0 && graph.numPath() > 0 && graph.vertexSize() > 128) {
+            throw std::runtime_error(
+                    "Simpath: Too many vertices for packed mates");
+        }
     }
 
-    Simpath(Simpath const& o, TdZddPool& pool)
+    BasicSimpath(BasicSimpath const& o, TdZddPool& pool)
             : graph(o.graph), mate(o.mate, pool) {
     }
 
@@ -34,15 +49,32 @@ public:
         return mate.hashCode();
     }
 
-    bool equals(Simpath const& o) const {
+    bool equals(BasicSimpath const& o) const {
         return mate.equals(o.mate);
     }
 
+    /**
+     * 頂点番号を添字とする mate 配列. 添字の範囲はフロンティア.
+     */
+    MateArray const& mates() const {
+        return mate;
+    }
+
+    void save(std::ostream& os) const {
+        mate.save(os);
+    }
+
+    void load(std::istream& is) {
+        mate.load(is);
+    }
+
     int down(bool take, int fromIndex, int toIndex);
 
-    friend std::ostream& operator<<(std::ostream& os, Simpath const& o) {
+    friend std::ostream& operator<<(std::ostream& os, BasicSimpath const& o) {
         return os << o.mate;
     }
 };
 
+typedef BasicSimpath<> Simpath;
+
 #endif /* SIMPATH_HPP_ */
@@ -7,17 +7,19 @@
 
 #include "SlilinFilter.hpp"
 
+#include <algorithm>
 #include <cassert>
 
-int SlilinFilter::down(bool take, int fromIndex, int toIndex) {
+template<int W>
+int BasicSlilinFilter<W>::down(bool take, int fromIndex, int toIndex) {
     Graph::ArcNumber arc = fromIndex;
     Graph::ArcNumber nextArc = toIndex;
     assert(arc < nextArc);
-    assert(nextArc <= graph.arcSize());
+    assert(nextArc <= graph->arcSize());
     SlilinQuiz::HintIndex smax = sc.maxIndex();
 
     for (auto a = arc; a < nextArc; ++a) {
-        auto cnstr = graph.arcConstraints(a);
+        auto cnstr = graph->arcConstraints(a);
 
         if (take) {
             for (auto p = cnstr.begin(); p != cnstr.end(); ++p) {
@@ -25,7 +27,8 @@ int SlilinFilter::down(bool take, int fromIndex, int toIndex) {
                 if (smax < i) {
                     sc.setMaxIndex(i);
                     for (auto j = smax + 1; j <= i; ++j) {
-                        sc[j] = graph.initialCount(j);
+                        // 5 以上のヒントはどれも満たせないので 5 にまとめる
+                        sc[j] = std::min(graph->initialCount(j), 5);
                     }
                     smax = i;
                 }
@@ -39,7 +42,7 @@ int SlilinFilter::down(bool take, int fromIndex, int toIndex) {
         else {
             for (auto p = cnstr.begin(); p != cnstr.end(); ++p) {
                 SlilinQuiz::HintIndex i = p->index;
-                int c = (i <= smax) ? sc[i] : graph.initialCount(i);
+                int c = (i <= smax) ? sc[i] : graph->initialCount(i);
                 if (c > p->maxCount) return 0;
                 if (p->maxCount == 0) sc.setMinIndex(i + 1);
             }
@@ -48,3 +51,9 @@ int SlilinFilter::down(bool take, int fromIndex, int toIndex) {
 
     return toIndex;
 }
+
+template class BasicSlilinFilter<0>;
+template class BasicSlilinFilter<8>;
+template class BasicSlilinFilter<16>;
+template class BasicSlilinFilter<24>;
+template class BasicSlilinFilter<32>;
@@ -12,23 +12,28 @@
 
 #include "TdZddPool.hpp"
 #include "graph/SlilinQuiz.hpp"
-#include "util/ShiftedArray.hpp"
+#include "util/PackedArray.hpp"
 
-class SlilinFilter {
+/**
+ * 辺の数がヒントの数に合う組合せだけを残すフィルタ.
+ * @tparam W ヒントの窓の配列の物理サイズ. 0 なら実行時に決める.
+ *           正なら各ヒントの残りの辺の数を4ビットに詰めて持つ.
+ */
+template<int W = 0>
+class BasicSlilinFilter {
     typedef short SlitherCount;
 
-    SlilinQuiz const& graph;
-    ShiftedArray<SlitherCount> sc;
-
-    SlilinFilter(SlilinFilter const&);
-    SlilinFilter& operator=(SlilinFilter const&);
+    SlilinQuiz const* graph;
+    typename StateArray<SlitherCount,W,4>::Type sc;
 
 public:
-    SlilinFilter(SlilinQuiz const& graph)
-            : graph(graph), sc(graph.maxHintWindowSize(), 0, -1) {
+    static bool const podState = W > 0;
+
+    BasicSlilinFilter(SlilinQuiz const& graph)
+            : graph(&graph), sc(graph.maxHintWindowSize(), 0, -1) {
     }
 
-    SlilinFilter(SlilinFilter const& o, TdZddPool& pool)
+    BasicSlilinFilter(BasicSlilinFilter const& o, TdZddPool& pool)
             : graph(o.graph), sc(o.sc, pool) {
     }
 
@@ -36,15 +41,25 @@ public:
         return sc.hashCode();
     }
 
-    bool equals(SlilinFilter const& o) const {
+    bool equals(BasicSlilinFilter const& o) const {
         return sc.equals(o.sc);
     }
 
+    void save(std::ostream& os) const {
+        sc.save(os);
+    }
+
+    void load(std::istream& is) {
+        sc.load(is);
+    }
+
     int down(bool take, int fromIndex, int toIndex);
 
-    friend std::ostream& operator<<(std::ostream& os, SlilinFilter const& o) {
+    friend std::ostream& operator<<(std::ostream& os, BasicSlilinFilter const& o) {
         return os << o.sc;
     }
 };
 
+typedef BasicSlilinFilter<> SlilinFilter;
+
 #endif /* SLILINFILTER_HPP_ */
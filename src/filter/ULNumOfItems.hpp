@@ -8,6 +8,8 @@
 #ifndef ULNUMOFITEMS_HPP_
 #define ULNUMOFITEMS_HPP_
 
+#include <iostream>
+
 #include "TdZddPool.hpp"
 #include "NumOfItems.hpp"
 
@@ -31,6 +33,14 @@ public:
         return count == o.count;
     }
 
+    void save(std::ostream& os) const {
+        os.write(reinterpret_cast<char const*>(&count), sizeof(count));
+    }
+
+    void load(std::istream& is) {
+        is.read(reinterpret_cast<char*>(&count), sizeof(count));
+    }
+
     int down(bool take, int fromIndex, int toIndex, Range r) {
         if (r.max < 0) return 0;
         if (count < r.min) return 0;
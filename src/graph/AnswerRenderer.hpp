@@ -0,0 +1,145 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: AnswerRenderer.hpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#ifndef ANSWERRENDERER_HPP_
+#define ANSWERRENDERER_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Graph.hpp"
+
+/**
+ * 解の図の高速な描画.
+ * 図を固定の文字列と, 周囲の辺の有無で形の変わる文字の並びとして前もって組み立て,
+ * 解毎には辺の表を引いて文字列を連結するだけで済ませる.
+ * 辺の表は描画の前後で解に含まれる辺だけを書き換えるので, 描画毎の確保は生じない.
+ * 並列に使う場合はスレッド毎に複製する.
+ */
+class AnswerRenderer {
+public:
+    typedef Graph::ArcNumber ArcNumber;
+
+private:
+    /**
+     * 形の変わる文字. 直前までの固定の文字列に続けて置く.
+     */
+    struct Slot {
+        size_t textEnd;     ///< 直前の固定の文字列の texts 内での終わり.
+        size_t glyphs;      ///< 文字の表の glyphs 内での先頭.
+        ArcNumber arcs[4];  ///< 表の添字の各ビットに対応する辺.
+    };
+
+    ArcNumber none;                 ///< 常に解に含まれない辺として扱う番号.
+    std::string texts;              ///< 固定の文字列を連結したもの.
+    std::vector<Slot> slots;        ///< 形の変わる文字の並び.
+    std::vector<std::string> glyphs; ///< 文字の表を連結したもの.
+    std::vector<uint8_t> taken;     ///< 辺番号で引く, 解に含まれるか.
+    std::string buffer;             ///< write() の出力バッファ.
+
+    static size_t const BUFFER_SIZE = 1 << 20;
+
+public:
+    /**
+     * @param arcSize 辺の数.
+     */
+    explicit AnswerRenderer(ArcNumber arcSize = 0)
+            : none(arcSize), taken(arcSize + 1) {
+    }
+
+    /**
+     * 辺がないことを表す番号. glyph() で使う.
+     */
+    ArcNumber noArc() const {
+        return none;
+    }
+
+    /**
+     * 文字の表を登録する.
+     * @param table 添字のビットが辺の有無を表す文字の表.
+     * @param size 表の大きさ.
+     * @return glyph() に渡す表の番号.
+     */
+    size_t glyphTable(char const* const * table, size_t size) {
+        size_t const k = glyphs.size();
+        glyphs.insert(glyphs.end(), table, table + size);
+        return k;
+    }
+
+    /**
+     * 固定の文字列を追加する.
+     */
+    void text(std::string const& s) {
+        texts += s;
+    }
+
+    /**
+     * 形の変わる文字を追加する. 表の添字のビット i は辺 ai の有無を表す.
+     * @param table glyphTable() の返した表の番号.
+     */
+    void glyph(size_t table, ArcNumber a0, ArcNumber a1, ArcNumber a2,
+            ArcNumber a3) {
+        Slot s = { texts.size(), table, { a0, a1, a2, a3 } };
+        slots.push_back(s);
+    }
+
+    void glyph(size_t table, ArcNumber a0) {
+        glyph(table, a0, none, none, none);
+    }
+
+    /**
+     * 解の図を out の末尾に追加する.
+     * @param b 解に含まれる辺の番号の列の先頭.
+     * @param e 解に含まれる辺の番号の列の終わり.
+     */
+    template<typename Iterator>
+    void render(std::string& out, Iterator b, Iterator e) {
+        for (Iterator p = b; p != e; ++p) {
+            taken[*p] = 1;
+        }
+
+        size_t pos = 0;
+        for (Slot const& s : slots) {
+            out.append(texts, pos, s.textEnd - pos);
+            pos = s.textEnd;
+            int const c = taken[s.arcs[0]] | (taken[s.arcs[1]] << 1)
+                    | (taken[s.arcs[2]] << 2) | (taken[s.arcs[3]] << 3);
+            out += glyphs[s.glyphs + c];
+        }
+        out.append(texts, pos, std::string::npos);
+
+        for (Iterator p = b; p != e; ++p) {
+            taken[*p] = 0;
+        }
+    }
+
+    template<typename Answer>
+    void operator()(std::string& out, Answer const& answer) {
+        render(out, answer.begin(), answer.end());
+    }
+
+    /**
+     * 解の図を内部のバッファに追加し, 溜まったら fp にまとめて書き出す.
+     */
+    template<typename Answer>
+    void write(std::FILE* fp, Answer const& answer) {
+        render(buffer, answer.begin(), answer.end());
+        if (buffer.size() >= BUFFER_SIZE) flush(fp);
+    }
+
+    /**
+     * 内部のバッファの内容を fp に書き出す.
+     */
+    void flush(std::FILE* fp) {
+        std::fwrite(buffer.data(), 1, buffer.size(), fp);
+        buffer.clear();
+    }
+};
+
+#endif /* ANSWERRENDERER_HPP_ */
@@ -7,18 +7,293 @@
 
 #include "Graph.hpp"
 
+#include <algorithm>
+#include <deque>
 #include <stdexcept>
 
+namespace {
+
+char const* const orderingNames[] = { "given", "bfs", "cm", "greedy", "auto" };
+
+}
+
+char const* Graph::orderingName(Ordering o) {
+    return orderingNames[o];
+}
+
+bool Graph::parseOrdering(std::string const& name, Ordering& o) {
+    for (int i = AS_GIVEN; i <= AUTO; ++i) {
+        if (name == orderingNames[i]) {
+            o = Ordering(i);
+            return true;
+        }
+    }
+    return false;
+}
+
 void Graph::reset() {
     elements.clear();
     arcIndex.clear();
     connectedVertices_.clear();
     leavingVertices_.clear();
     theLastArc_.clear();
+    renumber_.clear();
+    originalVertex_.clear();
+    originalArc_.clear();
     vMax = 0;
 }
 
+/**
+ * v と同じ連結成分で, 幅優先探索の深さが最大になる頂点を探す.
+ * 最も深い頂点のうち次数最小のものから探し直し, 深さが増えなくなるまで繰り返す.
+ * @param done 番号付け済みの頂点. 探索しない.
+ */
+Graph::VertexNumber Graph::peripheralVertex(VertexNumber v,
+        std::vector<bool> const& done) const {
+    std::vector<int> depth(vMax + 1);
+    int ecc = -1;
+
+    for (;;) {
+        std::fill(depth.begin(), depth.end(), -1);
+        std::deque<VertexNumber> queue(1, v);
+        depth[v] = 0;
+        VertexNumber last = v;
+
+        while (!queue.empty()) {
+            VertexNumber u = queue.front();
+            queue.pop_front();
+            for (VertexNumber w : connectedVertices_[u]) {
+                if (done[w] || depth[w] >= 0) continue;
+                depth[w] = depth[u] + 1;
+                queue.push_back(w);
+                if (depth[w] > depth[last]
+                        || (depth[w] == depth[last]
+                                && connectedVertices_[w].size()
+                                        < connectedVertices_[last].size())) {
+                    last = w;
+                }
+            }
+        }
+
+        if (depth[last] <= ecc) return v;
+        ecc = depth[last];
+        v = last;
+    }
+}
+
+/**
+ * 連結成分毎に周辺の頂点から幅優先探索した順.
+ * @param byDegree 隣接頂点を次数の小さい順にたどるか (Cuthill-McKee).
+ */
+std::vector<Graph::VertexNumber> Graph::searchOrder(bool byDegree) const {
+    std::vector<VertexNumber> order;
+    std::vector<bool> done(vMax + 1);
+    std::vector<VertexNumber> next;
+
+    for (VertexNumber s = 1; s <= vMax; ++s) {
+        if (done[s]) continue;
+        VertexNumber const start = peripheralVertex(s, done);
+        size_t head = order.size();
+        order.push_back(start);
+        done[start] = true;
+
+        while (head < order.size()) {
+            VertexNumber const u = order[head++];
+            next.clear();
+            for (VertexNumber w : connectedVertices_[u]) {
+                if (!done[w]) next.push_back(w);
+            }
+            std::sort(next.begin(), next.end());
+            if (byDegree) {
+                std::stable_sort(next.begin(), next.end(),
+                        [this](VertexNumber a, VertexNumber b) {
+                            return connectedVertices_[a].size()
+                                    < connectedVertices_[b].size();
+                        });
+            }
+            for (VertexNumber w : next) {
+                order.push_back(w);
+                done[w] = true;
+            }
+        }
+    }
+
+    return order;
+}
+
+/**
+ * 番号付け済みの頂点に隣接する頂点のうち, 未番号の隣接頂点を増やす数から
+ * 番号付けで隣接頂点がなくなるフロンティアの頂点の数を引いた値が
+ * 最小のものを順に選ぶ. 同点なら最も早く番号付けした隣接頂点を持つものを選ぶ.
+ */
+std::vector<Graph::VertexNumber> Graph::greedyOrder() const {
+    std::vector<VertexNumber> order;
+    std::vector<bool> done(vMax + 1);
+    std::vector<size_t> position(vMax + 1);
+    std::vector<int> rest(vMax + 1); ///< 未番号の隣接頂点の数.
+    std::vector<VertexNumber> candidates;
+    std::vector<bool> isCandidate(vMax + 1);
+
+    for (VertexNumber v = 1; v <= vMax; ++v) {
+        rest[v] = connectedVertices_[v].size();
+    }
+
+    for (VertexNumber s = 1; s <= vMax; ++s) {
+        if (done[s]) continue;
+        candidates.assign(1, peripheralVertex(s, done));
+        isCandidate[candidates[0]] = true;
+
+        while (!candidates.empty()) {
+            size_t best = 0;
+            int bestScore = 0;
+            size_t bestFirst = 0;
+
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                VertexNumber const v = candidates[i];
+                int score = 0;
+                size_t first = order.size();
+                for (VertexNumber w : connectedVertices_[v]) {
+                    if (!done[w]) {
+                        if (!isCandidate[w]) ++score;
+                    }
+                    else {
+                        if (rest[w] == 1) --score;
+                        first = std::min(first, position[w]);
+                    }
+                }
+                if (i == 0 || score < bestScore
+                        || (score == bestScore
+                                && (first < bestFirst
+                                        || (first == bestFirst
+                                                && v < candidates[best])))) {
+                    best = i;
+                    bestScore = score;
+                    bestFirst = first;
+                }
+            }
+
+            VertexNumber const v = candidates[best];
+            candidates[best] = candidates.back();
+            candidates.pop_back();
+            isCandidate[v] = false;
+            position[v] = order.size();
+            order.push_back(v);
+            done[v] = true;
+
+            for (VertexNumber w : connectedVertices_[v]) {
+                --rest[w];
+                if (!done[w] && !isCandidate[w]) {
+                    candidates.push_back(w);
+                    isCandidate[w] = true;
+                }
+            }
+        }
+    }
+
+    return order;
+}
+
+/**
+ * 番号付けした場合の maxFrontierSize().
+ * @param order 新しい番号の順に並べた元の頂点番号の列.
+ */
+Graph::VertexNumber Graph::orderWidth(
+        std::vector<VertexNumber> const& order) const {
+    std::vector<VertexNumber> number(vMax + 1);
+    for (size_t k = 0; k < order.size(); ++k) {
+        number[order[k]] = k + 1;
+    }
+
+    VertexNumber n = 0;
+    for (VertexNumberPair const& vp : elements) {
+        VertexNumber const v1 = number[vp.first];
+        VertexNumber const v2 = number[vp.second];
+        VertexNumber m = (v1 < v2) ? v2 - v1 + 1 : v1 - v2 + 1;
+        if (n < m) n = m;
+    }
+    return n;
+}
+
+/**
+ * 頂点を番号付けし直し, 辺を新しい頂点の組の順に並べ直す.
+ * @param order 新しい番号の順に並べた元の頂点番号の列.
+ */
+void Graph::applyOrder(std::vector<VertexNumber> const& order) {
+    assert(order.size() == vMax);
+    renumber_.assign(vMax + 1, 0);
+    originalVertex_.assign(vMax + 1, 0);
+    for (size_t k = 0; k < order.size(); ++k) {
+        renumber_[order[k]] = k + 1;
+        originalVertex_[k + 1] = order[k];
+    }
+
+    std::vector<std::pair<VertexNumberPair,ArcNumber>> arcs;
+    for (ArcNumber a = 0; a < elements.size(); ++a) {
+        VertexNumber v1 = renumber_[elements[a].first];
+        VertexNumber v2 = renumber_[elements[a].second];
+        if (v1 > v2) std::swap(v1, v2);
+        arcs.push_back(std::make_pair(VertexNumberPair(v1, v2), a));
+    }
+    std::sort(arcs.begin(), arcs.end());
+
+    elements.clear();
+    arcIndex.clear();
+    originalArc_.clear();
+    connectedVertices_.assign(vMax + 1, std::vector<VertexNumber>());
+    for (auto const& p : arcs) {
+        VertexNumberPair const& vp = p.first;
+        arcIndex.insert(std::make_pair(vp, ArcNumber(elements.size())));
+        elements.push_back(vp);
+        originalArc_.push_back(p.second);
+        connectedVertices_[vp.first].push_back(vp.second);
+        connectedVertices_[vp.second].push_back(vp.first);
+    }
+}
+
+/**
+ * 設定した方法で頂点を番号付けし直す. AS_GIVEN では何もしない.
+ * AUTO では入力の順も候補とし, フロンティアの幅が同じなら先の候補を選ぶ.
+ */
+void Graph::reorder() {
+    if (ordering_ == AS_GIVEN) return;
+    connectedVertices_.resize(vMax + 1);
+
+    std::vector<std::vector<VertexNumber>> orders;
+    if (ordering_ == AUTO) {
+        std::vector<VertexNumber> given(vMax);
+        for (VertexNumber v = 1; v <= vMax; ++v) {
+            given[v - 1] = v;
+        }
+        orders.push_back(given);
+        orderCandidates(orders);
+    }
+    if (ordering_ == BFS || ordering_ == AUTO) {
+        orders.push_back(searchOrder(false));
+    }
+    if (ordering_ == CUTHILL_MCKEE || ordering_ == AUTO) {
+        orders.push_back(searchOrder(true));
+    }
+    if (ordering_ == GREEDY || ordering_ == AUTO) {
+        orders.push_back(greedyOrder());
+    }
+
+    size_t best = 0;
+    VertexNumber bestWidth = orderWidth(orders[0]);
+    for (size_t i = 1; i < orders.size(); ++i) {
+        VertexNumber const w = orderWidth(orders[i]);
+        if (w < bestWidth) {
+            best = i;
+            bestWidth = w;
+        }
+    }
+
+    if (ordering_ == AUTO && best == 0) return;
+    applyOrder(orders[best]);
+}
+
 void Graph::setup() {
+    reorder();
+
     int const n = elements.size();
     theLastArc_.resize(vMax + 1);
     for (int i = 0; i < n; ++i) {
@@ -128,7 +403,8 @@ Graph::VertexNumber Graph::maxFrontierSize() const {
 std::ostream& operator<<(std::ostream& os, Graph const& g) {
     os << "graph {\n";
     for (auto a = g.elements.begin(); a != g.elements.end(); ++a) {
-        os << "  " << a->first << " -- " << a->second << ";\n";
+        os << "  " << g.originalVertex(a->first) << " -- "
+                << g.originalVertex(a->second) << ";\n";
     }
     os << "}\n";
     os.flush();
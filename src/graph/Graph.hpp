@@ -11,6 +11,7 @@
 #include <cassert>
 #include <iostream>
 #include <map>
+#include <string>
 #include <vector>
 
 class Graph {
@@ -20,7 +21,23 @@ public:
     typedef unsigned int PathNumber;
     typedef std::pair<VertexNumber,VertexNumber> VertexNumberPair;
 
+    /**
+     * 頂点の番号付けの方法.
+     * 辺は番号付け後の頂点の組の順に並べ直すので, フロンティアの幅が変わる.
+     */
+    enum Ordering {
+        AS_GIVEN,      ///< 入力の順のまま.
+        BFS,           ///< 周辺の頂点から始める幅優先探索の順.
+        CUTHILL_MCKEE, ///< 次数の小さい隣接頂点を先にたどる幅優先探索の順.
+        GREEDY,        ///< フロンティアの増加が最小の頂点を順に選ぶ.
+        AUTO           ///< 上記と派生クラスの候補のうちフロンティアの幅が最小のもの.
+    };
+
 private:
+    Ordering ordering_;
+    std::vector<VertexNumber> renumber_;       ///< 元の頂点番号から現在の番号.
+    std::vector<VertexNumber> originalVertex_; ///< 現在の頂点番号から元の番号.
+    std::vector<ArcNumber> originalArc_;       ///< 現在の辺番号から元の番号.
     std::vector<VertexNumberPair> elements;
     std::map<VertexNumberPair,ArcNumber> arcIndex;
     std::vector<std::vector<VertexNumber>> connectedVertices_;
@@ -31,7 +48,63 @@ private:
     std::vector<PathNumber> pathNumber_;
     PathNumber numPath_;
 
+    std::vector<VertexNumber> searchOrder(bool byDegree) const;
+    std::vector<VertexNumber> greedyOrder() const;
+    VertexNumber peripheralVertex(VertexNumber v,
+            std::vector<bool> const& done) const;
+    VertexNumber orderWidth(std::vector<VertexNumber> const& order) const;
+    void applyOrder(std::vector<VertexNumber> const& order);
+
 public:
+    Graph()
+            : ordering_(AS_GIVEN), vMax(0), numPath_(0) {
+    }
+
+    virtual ~Graph() {
+    }
+
+    /**
+     * 頂点の番号付けの方法を設定する. 次にグラフを構築した時から有効になる.
+     */
+    void setOrdering(Ordering o) {
+        ordering_ = o;
+    }
+
+    Ordering ordering() const {
+        return ordering_;
+    }
+
+    static char const* orderingName(Ordering o);
+
+    /**
+     * 名前から番号付けの方法を得る.
+     * @return 名前が正しければtrue.
+     */
+    static bool parseOrdering(std::string const& name, Ordering& o);
+
+    /**
+     * 元の頂点番号に対応する現在の頂点番号.
+     */
+    VertexNumber renumbered(VertexNumber v) const {
+        return renumber_.empty() ? v : renumber_[v];
+    }
+
+    /**
+     * 現在の頂点番号に対応する元の頂点番号.
+     */
+    VertexNumber originalVertex(VertexNumber v) const {
+        assert(1 <= v && v <= vMax);
+        return originalVertex_.empty() ? v : originalVertex_[v];
+    }
+
+    /**
+     * 現在の辺番号に対応する元の辺番号. 解を入力の辺番号で表す時に使う.
+     */
+    ArcNumber originalArc(ArcNumber a) const {
+        assert(0 <= a && size_t(a) < elements.size());
+        return originalArc_.empty() ? a : originalArc_[a];
+    }
+
     VertexNumber vertexSize() const {
         return vMax;
     }
@@ -64,7 +137,8 @@ public:
     std::string arcName(ArcNumber a) const {
         if (a < 0 || elements.size() <= size_t(a)) return "-";
         VertexNumberPair const& vp = elements[a];
-        return std::to_string(vp.first) + "," + std::to_string(vp.second);
+        return std::to_string(originalVertex(vp.first)) + ","
+                + std::to_string(originalVertex(vp.second));
     }
 
     ArcNumber theLastArc(VertexNumber v) const {
@@ -102,6 +176,15 @@ public:
 protected:
     void reset();
     void setup();
+    void reorder();
+
+    /**
+     * AUTO で比べる番号付けの候補を追加する.
+     * @param orders 候補の格納先. 各候補は新しい番号の順に並べた元の頂点番号の列.
+     */
+    virtual void orderCandidates(
+            std::vector<std::vector<VertexNumber>>& orders) const {
+    }
 };
 
 #endif /* GRAPH_HPP_ */
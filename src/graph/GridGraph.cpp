@@ -20,6 +20,9 @@ void GridGraph::resize(int rows, int cols) {
         }
     }
 
+    setup();
+
+    arcs.clear();
     arcs.resize((rows - 1) * (cols - 1));
 
     for (int y = 0; y < rows - 1; ++y) {
@@ -32,53 +35,69 @@ void GridGraph::resize(int rows, int cols) {
             a[3] = getArc(getVertex(y + 1, x), getVertex(y + 1, x + 1));
         }
     }
+}
 
-    setup();
+void GridGraph::orderCandidates(
+        std::vector<std::vector<VertexNumber>>& orders) const {
+    std::vector<VertexNumber> order;
+    for (int x = 0; x < cols_; ++x) {
+        for (int y = 0; y < rows_; ++y) {
+            order.push_back(cols_ * y + x + 1);
+        }
+    }
+    orders.push_back(order);
 }
 
-void GridGraph::printAnswer(std::ostream& os,
-        std::set<ArcNumber> const& answer) const {
+AnswerRenderer GridGraph::answerRenderer() const {
     static char const* connector[] = { " ", "╴", "╶", "─", "╵", "┘", "└", "┴",
             "╷", "┐", "┌", "┬", "│", "┤", "├", "┼" };
 
-    os << "┏";
+    AnswerRenderer r(arcSize());
+    size_t const table = r.glyphTable(connector, 16);
+    ArcNumber const none = r.noArc();
+
+    r.text("┏");
     for (int x = 0; x < cols(); ++x) {
-        os << "━";
+        r.text("━");
     }
-    os << "┓\n";
+    r.text("┓\n");
 
     for (int y = 0; y < rows(); ++y) {
-        os << "┃";
+        r.text("┃");
 
         for (int x = 0; x < cols(); ++x) {
-            int c = 0;
+            ArcNumber a[4] = { none, none, none, none };
             if (x - 1 >= 0) {
-                ArcNumber a = getArc(getVertex(y, x - 1), getVertex(y, x));
-                if (answer.count(a)) c |= 1;
+                a[0] = getArc(getVertex(y, x - 1), getVertex(y, x));
             }
             if (x + 1 < cols()) {
-                ArcNumber a = getArc(getVertex(y, x), getVertex(y, x + 1));
-                if (answer.count(a)) c |= 2;
+                a[1] = getArc(getVertex(y, x), getVertex(y, x + 1));
             }
             if (y - 1 >= 0) {
-                ArcNumber a = getArc(getVertex(y - 1, x), getVertex(y, x));
-                if (answer.count(a)) c |= 4;
+                a[2] = getArc(getVertex(y - 1, x), getVertex(y, x));
             }
             if (y + 1 < rows()) {
-                ArcNumber a = getArc(getVertex(y, x), getVertex(y + 1, x));
-                if (answer.count(a)) c |= 8;
+                a[3] = getArc(getVertex(y, x), getVertex(y + 1, x));
             }
-            os << connector[c];
+            r.glyph(table, a[0], a[1], a[2], a[3]);
         }
 
-        os << "┃\n";
+        r.text("┃\n");
     }
 
-    os << "┗";
+    r.text("┗");
     for (int x = 0; x < cols(); ++x) {
-        os << "━";
+        r.text("━");
     }
-    os << "┛\n";
+    r.text("┛\n");
+    return r;
+}
+
+void GridGraph::printAnswer(std::ostream& os,
+        std::set<ArcNumber> const& answer) const {
+    std::string s;
+    answerRenderer().render(s, answer.begin(), answer.end());
+    os << s;
 }
 
 void GridGraph::printQuiz(std::ostream& os) const {
@@ -11,6 +11,7 @@
 #include <set>
 #include <vector>
 
+#include "AnswerRenderer.hpp"
 #include "Graph.hpp"
 
 class GridGraph: public Graph {
@@ -41,7 +42,7 @@ public:
     VertexNumber getVertex(int y, int x) const {
         assert(0 <= y && y < rows_);
         assert(0 <= x && x < cols_);
-        return cols_ * y + x + 1;
+        return renumbered(cols_ * y + x + 1);
     }
 
     VertexNumber getVertex(int y, int x, int rotate) const {
@@ -65,9 +66,21 @@ public:
 
     virtual void resize(int rows, int cols);
 
+    /**
+     * 解の図を描く AnswerRenderer を作る. 図は printAnswer() と同じ.
+     */
+    virtual AnswerRenderer answerRenderer() const;
     virtual void printAnswer(std::ostream& os,
             std::set<ArcNumber> const& answer) const;
     virtual void printQuiz(std::ostream& os) const;
+
+protected:
+    /**
+     * 転置した格子の順 (列毎の番号付け) を候補に加える.
+     * 幅の広い格子ではこれが最もフロンティアの幅が小さい.
+     */
+    virtual void orderCandidates(
+            std::vector<std::vector<VertexNumber>>& orders) const;
 };
 
 #endif /* GRIDGRAPH_HPP_ */
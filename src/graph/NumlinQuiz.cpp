@@ -8,6 +8,7 @@
 #include "NumlinQuiz.hpp"
 
 #include <iomanip>
+#include <sstream>
 
 void NumlinQuiz::resize(int rows, int cols) {
     GridGraph::resize(rows, cols);
@@ -104,67 +105,71 @@ void NumlinQuiz::readQuiz(std::istream& is) {
     }
 }
 
-void NumlinQuiz::printAnswer(std::ostream& os,
-        std::set<ArcNumber> const& answer) const {
+AnswerRenderer NumlinQuiz::answerRenderer() const {
     static char const* connector[] = { "  ", "  ", "  ", "──", "  ", "─┘", " └",
             "─┴", "  ", "─┐", " ┌", "─┬", " │", "─┤", " ├", "─┼" };
 
-    os << "┏";
+    AnswerRenderer r(arcSize());
+    size_t const table = r.glyphTable(connector, 16);
+    ArcNumber const none = r.noArc();
+
+    r.text("┏");
     for (int x = 0; x < cols(); ++x) {
-        os << "━━";
+        r.text("━━");
     }
-    os << "━┓\n";
+    r.text("━┓\n");
 
     for (int y = 0; y < rows(); ++y) {
-        os << "┃";
+        r.text("┃");
 
         for (int x = 0; x < cols(); ++x) {
             int h = hint(y, x);
             if (h >= 0) {
+                std::ostringstream os;
                 os << std::setw(2) << h;
+                r.text(os.str());
             }
             else {
-                int c = 0;
+                ArcNumber a[4] = { none, none, none, none };
                 if (x - 1 >= 0) {
-                    ArcNumber a = getArc(getVertex(y, x - 1), getVertex(y, x));
-                    if (answer.count(a)) c |= 1;
+                    a[0] = getArc(getVertex(y, x - 1), getVertex(y, x));
                 }
                 if (x + 1 < cols()) {
-                    ArcNumber a = getArc(getVertex(y, x), getVertex(y, x + 1));
-                    if (answer.count(a)) c |= 2;
+                    a[1] = getArc(getVertex(y, x), getVertex(y, x + 1));
                 }
                 if (y - 1 >= 0) {
-                    ArcNumber a = getArc(getVertex(y - 1, x), getVertex(y, x));
-                    if (answer.count(a)) c |= 4;
+                    a[2] = getArc(getVertex(y - 1, x), getVertex(y, x));
                 }
                 if (y + 1 < rows()) {
-                    ArcNumber a = getArc(getVertex(y, x), getVertex(y + 1, x));
-                    if (answer.count(a)) c |= 8;
+                    a[3] = getArc(getVertex(y, x), getVertex(y + 1, x));
                 }
-                os << connector[c];
+                r.glyph(table, a[0], a[1], a[2], a[3]);
             }
         }
 
-        os << " ┃\n";
+        r.text(" ┃\n");
     }
 
-    os << "┗";
+    r.text("┗");
     for (int x = 0; x < cols(); ++x) {
-        os << "━━";
+        r.text("━━");
     }
-    os << "━┛\n";
+    r.text("━┛\n");
+    return r;
 }
 
 std::ostream& operator<<(std::ostream& os, NumlinQuiz const& g) {
     os << "graph {\n";
-    for (NumlinQuiz::VertexNumber v = 0; v <= g.vertexSize(); ++v) {
+    for (NumlinQuiz::VertexNumber v = 1; v <= g.vertexSize(); ++v) {
         if (g.hint_[v] >= 0) {
-            os << "  " << v << " [label=\"" << g.hint_[v] << "\"];\n";
+            os << "  " << g.originalVertex(v) << " [label=\"" << g.hint_[v]
+                    << "\"];\n";
         }
     }
     for (NumlinQuiz::ArcNumber a = 0; a < g.arcSize(); ++a) {
         auto vp = g.vertexPair(a);
-        os << "  " << vp.first << " -- " << vp.second << "\n";
+        os << "  " << g.originalVertex(vp.first) << " -- "
+                << g.originalVertex(vp.second) << "\n";
     }
     os << "}\n";
     os.flush();
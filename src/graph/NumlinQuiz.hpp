@@ -29,8 +29,7 @@ public:
     void putNumber(int y, int x, int n);
     void readQuiz(std::istream& is);
 
-    virtual void printAnswer(std::ostream& os,
-            std::set<ArcNumber> const& answer) const;
+    virtual AnswerRenderer answerRenderer() const;
 
     friend std::ostream& operator<<(std::ostream& os, NumlinQuiz const& g);
 };
@@ -7,8 +7,10 @@
 
 #include "SlilinQuiz.hpp"
 
-#include <vector>
+#include <algorithm>
 #include <sstream>
+#include <string>
+#include <vector>
 
 void SlilinQuiz::resize(int rows, int cols) {
     GridGraph::resize(rows, cols);
@@ -52,15 +54,20 @@ void SlilinQuiz::putNumber(int y, int x, int n) {
 
 void SlilinQuiz::sortHintIndices() {
     int const n = initialCount_.size();
-    std::vector<HintIndex> perm(n);
+    std::vector<int> rest(n);
+    for (auto const& constraints : arcConstraints_) {
+        for (Constraint const& c : constraints) {
+            ++rest[c.index];
+        }
+    }
 
+    // 辺の順に残りの辺の数を数え直し, 最後の辺の順にヒントを番号付ける
+    std::vector<HintIndex> perm(n);
     int i = 0;
-    for (int y = 0; y < rows() - 1; ++y) {
-        for (int x = 0; x < cols() - 1; ++x) {
-            ArcNumber as = getArc(getVertex(y + 1, x), getVertex(y + 1, x + 1));
-            for (Constraint const& c : arcConstraints_[as]) {
-                if (c.maxCount == 0) perm[c.index] = i++;
-            }
+    for (auto& constraints : arcConstraints_) {
+        for (Constraint& c : constraints) {
+            c.maxCount = --rest[c.index];
+            if (c.maxCount == 0) perm[c.index] = i++;
         }
     }
 
@@ -74,6 +81,10 @@ void SlilinQuiz::sortHintIndices() {
         for (Constraint& c : constraints) {
             c.index = perm[c.index];
         }
+        std::sort(constraints.begin(), constraints.end(),
+                [](Constraint const& a, Constraint const& b) {
+                    return a.index < b.index;
+                });
     }
 }
 
@@ -164,7 +175,7 @@ void SlilinQuiz::readQuiz(std::istream& is) {
         ++x;
     }
 
-    if (rot) sortHintIndices();
+    sortHintIndices();
 }
 
 namespace {
@@ -332,7 +343,7 @@ void SlilinQuiz::readPicture(std::istream& is) {
         arcTaken_[as] = pict.get(rows - 1, x) ^ pict.get(rows, x);
     }
 
-    if (rot) sortHintIndices();
+    sortHintIndices();
 }
 
 void SlilinQuiz::readAnswer(std::istream& is) {
@@ -421,7 +432,7 @@ void SlilinQuiz::readAnswer(std::istream& is) {
         }
     }
 
-    if (rot) sortHintIndices();
+    sortHintIndices();
 }
 
 void SlilinQuiz::readAnswerOrQuiz(std::istream& is) {
@@ -495,82 +506,88 @@ SlilinQuiz::HintIndex SlilinQuiz::maxHintWindowSize() const {
     return size;
 }
 
-void SlilinQuiz::printQuiz(std::ostream& os, std::vector<std::vector<int>> hint,
-        std::set<ArcNumber> const& answer) const {
+AnswerRenderer SlilinQuiz::answerRenderer(
+        std::vector<std::vector<int>> const& hint) const {
     static char const* connector[] = { " ", " ", " ", "─", " ", "┘", "└", "┴",
             " ", "┐", "┌", "┬", "│", "┤", "├", "┼" };
+    static char const* hline[] = { " ", "─" };
+    static char const* vline[] = { " ", "│" };
     int const ny = (rot & 1) ? cols() : rows();
     int const nx = (rot & 1) ? rows() : cols();
 
-    os << "┏";
+    AnswerRenderer r(arcSize());
+    size_t const table = r.glyphTable(connector, 16);
+    size_t const htable = r.glyphTable(hline, 2);
+    size_t const vtable = r.glyphTable(vline, 2);
+    ArcNumber const none = r.noArc();
+
+    r.text("┏");
     for (int x = 0; x < nx; ++x) {
-        os << "━━";
+        r.text("━━");
     }
-    os << "━┓\n";
+    r.text("━┓\n");
 
     for (int y = 0; y < ny; ++y) {
-        os << "┃ ";
+        r.text("┃ ");
 
         for (int x = 0; x < nx; ++x) {
-            int c = 0;
+            ArcNumber a[4] = { none, none, none, none };
             if (x - 1 >= 0) {
-                ArcNumber a = getArc(getVertex(y, x - 1, rot),
-                        getVertex(y, x, rot));
-                if (answer.count(a)) c |= 1;
+                a[0] = getArc(getVertex(y, x - 1, rot), getVertex(y, x, rot));
             }
             if (x + 1 < nx) {
-                ArcNumber a = getArc(getVertex(y, x, rot),
-                        getVertex(y, x + 1, rot));
-                if (answer.count(a)) c |= 2;
+                a[1] = getArc(getVertex(y, x, rot), getVertex(y, x + 1, rot));
             }
             if (y - 1 >= 0) {
-                ArcNumber a = getArc(getVertex(y - 1, x, rot),
-                        getVertex(y, x, rot));
-                if (answer.count(a)) c |= 4;
+                a[2] = getArc(getVertex(y - 1, x, rot), getVertex(y, x, rot));
             }
             if (y + 1 < ny) {
-                ArcNumber a = getArc(getVertex(y, x, rot),
-                        getVertex(y + 1, x, rot));
-                if (answer.count(a)) c |= 8;
+                a[3] = getArc(getVertex(y, x, rot), getVertex(y + 1, x, rot));
             }
-            os << connector[c];
+            r.glyph(table, a[0], a[1], a[2], a[3]);
 
-            if (x + 1 < nx) {
-                ArcNumber a = getArc(getVertex(y, x, rot),
-                        getVertex(y, x + 1, rot));
-                os << (answer.count(a) ? "─" : " ");
-            }
+            if (x + 1 < nx) r.glyph(htable, a[1]);
         }
 
-        os << " ┃\n";
+        r.text(" ┃\n");
 
         if (y + 1 < ny) {
-            os << "┃ ";
+            r.text("┃ ");
 
             for (int x = 0; x < nx; ++x) {
-                ArcNumber a = getArc(getVertex(y, x, rot),
-                        getVertex(y + 1, x, rot));
-                os << (answer.count(a) ? "│" : " ");
+                r.glyph(vtable,
+                        getArc(getVertex(y, x, rot), getVertex(y + 1, x, rot)));
 
                 if (x + 1 < nx) {
-                    int r = rot & 3;
-                    int n = (r == 1) ? hint[nx - x - 2][y] :
-                            (r == 2) ? hint[ny - y - 2][nx - x - 2] :
-                            (r == 3) ? hint[x][ny - y - 2] : hint[y][x];
-                    if (n >= 0) os << n;
-                    else os << " ";
+                    int rr = rot & 3;
+                    int n = (rr == 1) ? hint[nx - x - 2][y] :
+                            (rr == 2) ? hint[ny - y - 2][nx - x - 2] :
+                            (rr == 3) ? hint[x][ny - y - 2] : hint[y][x];
+                    r.text(n >= 0 ? std::to_string(n) : " ");
                 }
             }
 
-            os << " ┃\n";
+            r.text(" ┃\n");
         }
     }
 
-    os << "┗";
+    r.text("┗");
     for (int x = 0; x < nx; ++x) {
-        os << "━━";
+        r.text("━━");
     }
-    os << "━┛\n";
+    r.text("━┛\n");
+    return r;
+}
+
+AnswerRenderer SlilinQuiz::answerRenderer() const {
+    return answerRenderer(hint_);
+}
+
+void SlilinQuiz::printQuiz(std::ostream& os, std::vector<std::vector<int>> hint,
+        std::set<ArcNumber> const& answer) const {
+    std::string s;
+    answerRenderer(hint).render(s, answer.begin(), answer.end());
+    os << s;
 }
 
 void SlilinQuiz::printQuiz(std::ostream& os,
@@ -91,6 +91,12 @@ public:
     void readAnswerOrPicture(std::istream& is);
     HintIndex maxHintWindowSize() const;
 
+    /**
+     * 指定したヒントで解の図を描く AnswerRenderer を作る.
+     */
+    AnswerRenderer answerRenderer(
+            std::vector<std::vector<int>> const& hint) const;
+    virtual AnswerRenderer answerRenderer() const;
     virtual void printQuiz(std::ostream& os, std::vector<std::vector<int>> hint,
             std::set<ArcNumber> const& answer) const;
     virtual void printQuiz(std::ostream& os,
@@ -0,0 +1,146 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: hashbench.cpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "TdZddConcurrentHash.hpp"
+#include "TdZddHash.hpp"
+
+/*
+ * 一意表の競合ベンチマーク.
+ * mate配列を模した固定長の状態を多数生成し,
+ * ロックフリーの TdZddConcurrentHashTable と
+ * 排他ロック付きの TdZddHashMap で重複除去を行う時間を比較する.
+ */
+
+namespace {
+
+int const WIDTH = 16;
+
+struct States {
+    std::vector<short> data;
+
+    short const* get(size_t i) const {
+        return &data[i * WIDTH];
+    }
+
+    size_t hashCode(size_t i) const {
+        short const* p = get(i);
+        size_t h = 0;
+        for (int k = 0; k < WIDTH; ++k) {
+            h = h * 31 + p[k];
+        }
+        return h;
+    }
+
+    bool equals(size_t i, size_t j) const {
+        return std::memcmp(get(i), get(j), WIDTH * sizeof(short)) == 0;
+    }
+};
+
+double wtime() {
+#ifdef _OPENMP
+    return omp_get_wtime();
+#else
+    return 0;
+#endif
+}
+
+void usage(char const* cmd) {
+    std::cerr << "usage: " << cmd << " [<items> [<distinct> [<threads>]]]\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    size_t items = 4000000;
+    size_t distinct = 1000000;
+    int maxThreads = 1;
+#ifdef _OPENMP
+    maxThreads = omp_get_max_threads();
+#endif
+
+    if (argc > 4) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (argc > 1) items = std::strtoul(argv[1], 0, 10);
+    if (argc > 2) distinct = std::strtoul(argv[2], 0, 10);
+    if (argc > 3) maxThreads = std::atoi(argv[3]);
+    if (items == 0 || distinct == 0 || maxThreads <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // 重複を含む状態列を生成する
+    States states;
+    {
+        std::mt19937_64 rng(1);
+        std::vector<short> pool(distinct * WIDTH);
+        for (size_t i = 0; i < pool.size(); ++i) {
+            pool[i] = rng() % (WIDTH + 1);
+        }
+        states.data.resize(items * WIDTH);
+        for (size_t i = 0; i < items; ++i) {
+            std::memcpy(&states.data[i * WIDTH],
+                    &pool[(rng() % distinct) * WIDTH], WIDTH * sizeof(short));
+        }
+    }
+
+    std::cout << "items = " << items << ", distinct <= " << distinct << "\n";
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "lock-free"
+            << std::setw(14) << "mutex" << std::setw(10) << "uniq" << "\n";
+
+    std::vector<size_t> slot(items);
+    TdZddConcurrentHashTable<States> cuniq;
+    TdZddHashMap<size_t,size_t> uniq;
+
+    for (int nt = 1; nt <= maxThreads; nt *= 2) {
+        // ロックフリー
+        cuniq.initialize(states, items);
+        double t0 = wtime();
+#pragma omp parallel for schedule(static) num_threads(nt)
+        for (intptr_t j = 0; j < intptr_t(items); ++j) {
+            slot[j] = cuniq.add(j);
+        }
+        double t1 = wtime();
+
+        size_t n = 0;
+        for (size_t j = 0; j < items; ++j) {
+            if (cuniq.representative(slot[j]) == j) ++n;
+        }
+
+        // 排他ロック (状態のハッシュ値で比較し, 衝突は無視する)
+        std::mutex mtx;
+        uniq.initialize(items);
+        double t2 = wtime();
+#pragma omp parallel for schedule(static) num_threads(nt)
+        for (intptr_t j = 0; j < intptr_t(items); ++j) {
+            size_t h = states.hashCode(j);
+            std::lock_guard<std::mutex> lock(mtx);
+            uniq.put(h, j);
+        }
+        double t3 = wtime();
+
+        std::cout << std::setw(8) << nt << std::fixed << std::setprecision(3)
+                << std::setw(13) << (t1 - t0) << "s" << std::setw(13)
+                << (t3 - t2) << "s" << std::setw(10) << n << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,257 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: statebench.cpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "TdZddHash.hpp"
+#include "filter/Simpath.hpp"
+#include "graph/GridGraph.hpp"
+
+/*
+ * 状態のハッシュと比較のベンチマーク.
+ * n×n の格子で Simpath を無作為に途中までたどって mate 配列を集め,
+ * 従来の多項式ハッシュと要素ごとの比較を, hashBytes() と memcmp と比べる.
+ * 比較は別の領域に複製した同じ状態どうしで行う.
+ * ハッシュ値の偏りは, 2のべき乗の表と素数の表での平均探索長で示す.
+ */
+
+namespace {
+
+typedef Graph::VertexNumber VertexNumber;
+
+struct States {
+    std::vector<int> vmin;
+    std::vector<size_t> offset;
+    std::vector<VertexNumber> data;
+
+    size_t size() const {
+        return vmin.size();
+    }
+
+    VertexNumber const* get(size_t i) const {
+        return &data[offset[i]];
+    }
+
+    int length(size_t i) const {
+        return offset[i + 1] - offset[i];
+    }
+
+    size_t polyHash(size_t i) const {
+        VertexNumber const* p = get(i);
+        size_t h = vmin[i];
+        for (int k = 0; k < length(i); ++k) {
+            h = h * 31 + p[k];
+        }
+        return h;
+    }
+
+    size_t bytesHash(size_t i) const {
+        return hashBytes(get(i), length(i) * sizeof(VertexNumber), vmin[i]);
+    }
+
+    bool loopEquals(size_t i, States const& o, size_t j) const {
+        if (vmin[i] != o.vmin[j] || length(i) != o.length(j)) return false;
+        VertexNumber const* p = get(i);
+        VertexNumber const* q = o.get(j);
+        for (int k = 0; k < length(i); ++k) {
+            if (p[k] != q[k]) return false;
+        }
+        return true;
+    }
+
+    bool memcmpEquals(size_t i, States const& o, size_t j) const {
+        if (vmin[i] != o.vmin[j] || length(i) != o.length(j)) return false;
+        return std::memcmp(get(i), o.get(j),
+                length(i) * sizeof(VertexNumber)) == 0;
+    }
+};
+
+/**
+ * n×n の格子で Simpath を無作為にたどり, 辺の中ほどの相異なる状態を集める.
+ */
+States collect(int n, size_t count, std::mt19937_64& rng) {
+    GridGraph g(n, n);
+    int const m = g.arcSize();
+    States states;
+
+    Simpath const root(g);
+    TdZddPool pool;
+    std::unordered_set<std::string> seen;
+
+    while (states.size() < count) {
+        int const stop = m / 3 + rng() % (m / 3);
+        Simpath const* s = &root;
+        pool.clear();
+
+        int a = 0;
+        for (; a < stop; ++a) {
+            // 選んだ枝が棄却されたらもう一方の枝を試す
+            bool const take = rng() % 2 == 0;
+            Simpath* t = new (pool.allocate<Simpath>()) Simpath(*s, pool);
+            if (t->down(take, a, a + 1) <= 0) {
+                t = new (pool.allocate<Simpath>()) Simpath(*s, pool);
+                if (t->down(!take, a, a + 1) <= 0) break;
+            }
+            s = t;
+        }
+        if (a < stop) continue;
+
+        Simpath::MateArray const& mate = s->mates();
+        std::vector<VertexNumber> v;
+        for (int i = mate.minIndex(); i <= mate.maxIndex(); ++i) {
+            v.push_back(mate[i]);
+        }
+        std::ostringstream key;
+        key << mate.minIndex() << ':';
+        key.write(reinterpret_cast<char const*>(v.data()),
+                v.size() * sizeof(VertexNumber));
+        if (!seen.insert(key.str()).second) continue;
+
+        states.offset.push_back(states.data.size());
+        states.vmin.push_back(mate.minIndex());
+        states.data.insert(states.data.end(), v.begin(), v.end());
+    }
+
+    states.offset.push_back(states.data.size());
+    return states;
+}
+
+/**
+ * 線形探索法で全てのハッシュ値を入れたときの平均探索長を返す.
+ * @param prime 真なら size 以下の最大の素数を法とし, 偽なら2のべき乗の下位ビットを使う.
+ */
+double averageProbe(std::vector<size_t> const& hash, size_t size, bool prime) {
+    size_t mod = size;
+    if (prime) {
+        for (mod = size - 1;; --mod) {
+            bool p = true;
+            for (size_t d = 2; d * d <= mod; ++d) {
+                if (mod % d == 0) {
+                    p = false;
+                    break;
+                }
+            }
+            if (p) break;
+        }
+    }
+
+    std::vector<char> used(mod);
+    size_t total = 0;
+    for (size_t h : hash) {
+        size_t k = prime ? h % mod : h & (mod - 1);
+        while (used[k]) {
+            k = (k + 1 == mod) ? 0 : k + 1;
+            ++total;
+        }
+        used[k] = 1;
+    }
+    return double(total) / hash.size();
+}
+
+double wtime() {
+#ifdef _OPENMP
+    return omp_get_wtime();
+#else
+    return 0;
+#endif
+}
+
+void usage(char const* cmd) {
+    std::cerr << "usage: " << cmd << " [<states> [<repeat>]]\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    size_t count = 100000;
+    int repeat = 20;
+
+    if (argc > 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (argc > 1) count = std::strtoul(argv[1], 0, 10);
+    if (argc > 2) repeat = std::atoi(argv[2]);
+    if (count == 0 || repeat <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::cout << "states = " << count << ", repeat = " << repeat << "\n";
+    std::cout << std::setw(6) << "grid" << std::setw(8) << "width"
+            << std::setw(10) << "poly" << std::setw(10) << "bytes"
+            << std::setw(10) << "loop" << std::setw(10) << "memcmp"
+            << std::setw(9) << "poly2^k" << std::setw(9) << "polyP"
+            << std::setw(9) << "bytes2^k" << "\n";
+
+    std::mt19937_64 rng(1);
+    for (int n = 10; n <= 20; n += 2) {
+        States const states = collect(n, count, rng);
+        States const copy = states;
+        size_t const m = states.size();
+        double width = double(states.data.size()) / m;
+
+        std::vector<size_t> poly(m), bytes(m);
+        size_t sink = 0;
+
+        double t0 = wtime();
+        for (int r = 0; r < repeat; ++r) {
+            for (size_t i = 0; i < m; ++i) {
+                poly[i] = states.polyHash(i);
+            }
+            sink += poly[r % m];
+        }
+        double t1 = wtime();
+        for (int r = 0; r < repeat; ++r) {
+            for (size_t i = 0; i < m; ++i) {
+                bytes[i] = states.bytesHash(i);
+            }
+            sink += bytes[r % m];
+        }
+        double t2 = wtime();
+        for (int r = 0; r < repeat; ++r) {
+            for (size_t i = 0; i < m; ++i) {
+                sink += states.loopEquals(i, copy, i);
+            }
+        }
+        double t3 = wtime();
+        for (int r = 0; r < repeat; ++r) {
+            for (size_t i = 0; i < m; ++i) {
+                sink += states.memcmpEquals(i, copy, i);
+            }
+        }
+        double t4 = wtime();
+
+        size_t const size = tableSize(m);
+        std::cout << std::setw(6) << (std::to_string(n) + "x" + std::to_string(n))
+                << std::fixed << std::setprecision(1) << std::setw(8) << width
+                << std::setprecision(3)
+                << std::setw(9) << (t1 - t0) << "s"
+                << std::setw(9) << (t2 - t1) << "s"
+                << std::setw(9) << (t3 - t2) << "s"
+                << std::setw(9) << (t4 - t3) << "s"
+                << std::setprecision(2)
+                << std::setw(9) << averageProbe(poly, size, false)
+                << std::setw(9) << averageProbe(poly, size, true)
+                << std::setw(9) << averageProbe(bytes, size, false)
+                << ((sink == 0) ? " " : "") << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * Arbitrary-Precision Unsigned Integer
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: BigNumber.hpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#ifndef BIGNUMBER_HPP_
+#define BIGNUMBER_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * 64ビットの limb の列で表した符号なし多倍長整数.
+ * 組合せの数え上げに必要な加算と10進出力だけを持つ.
+ */
+class BigNumber {
+    std::vector<uint64_t> limb; ///< 下位から並べた limb. 最上位は0でない.
+
+public:
+    BigNumber() {
+    }
+
+    BigNumber(uint64_t n) {
+        if (n != 0) limb.push_back(n);
+    }
+
+    BigNumber(unsigned __int128 n) {
+        while (n != 0) {
+            limb.push_back(static_cast<uint64_t>(n));
+            n >>= 64;
+        }
+    }
+
+    /**
+     * limb の列から作る.
+     * @param p 下位から並べた limb.
+     * @param n limb の数.
+     */
+    BigNumber(uint64_t const* p, size_t n)
+            : limb(p, p + n) {
+        normalize();
+    }
+
+    /**
+     * limb の列の加算. dst は a または b と同じ領域でもよい.
+     * @param dst 結果の格納先. max(na, nb) + 1 個の limb を書ける領域.
+     * @param a 被加数.
+     * @param na 被加数の limb の数.
+     * @param b 加数.
+     * @param nb 加数の limb の数.
+     * @return 結果の limb の数. 最上位の0は含めない.
+     */
+    static size_t add(uint64_t* dst, uint64_t const* a, size_t na,
+            uint64_t const* b, size_t nb) {
+        if (na < nb) {
+            std::swap(a, b);
+            std::swap(na, nb);
+        }
+
+        uint64_t carry = 0;
+        size_t i = 0;
+        for (; i < nb; ++i) {
+            uint64_t const x = a[i];
+            uint64_t const s = x + b[i];
+            uint64_t const t = s + carry;
+            carry = (s < x) | (t < s);
+            dst[i] = t;
+        }
+        for (; i < na; ++i) {
+            uint64_t const t = a[i] + carry;
+            carry = (t < carry);
+            dst[i] = t;
+        }
+        if (carry != 0) dst[i++] = 1;
+
+        while (i > 0 && dst[i - 1] == 0) {
+            --i;
+        }
+        return i;
+    }
+
+    void swap(BigNumber& o) {
+        limb.swap(o.limb);
+    }
+
+    bool isZero() const {
+        return limb.empty();
+    }
+
+    size_t limbs() const {
+        return limb.size();
+    }
+
+    /**
+     * 下位から並べた limb の列. limbs() 個の要素を持つ.
+     */
+    uint64_t const* data() const {
+        return limb.data();
+    }
+
+    BigNumber& operator+=(BigNumber const& o) {
+        size_t const na = limb.size();
+        size_t const nb = o.limb.size();
+        if (nb == 0) return *this;
+        limb.resize(std::max(na, nb) + 1);
+        limb.resize(add(limb.data(), limb.data(), na, o.limb.data(), nb));
+        return *this;
+    }
+
+    BigNumber operator+(BigNumber const& o) const {
+        BigNumber n = *this;
+        return n += o;
+    }
+
+    bool operator==(BigNumber const& o) const {
+        return limb == o.limb;
+    }
+
+    bool operator!=(BigNumber const& o) const {
+        return limb != o.limb;
+    }
+
+    /**
+     * 倍精度浮動小数点数に変換する. 大きな値は丸められる.
+     */
+    double toDouble() const {
+        double d = 0;
+        for (size_t i = limb.size(); i > 0; --i) {
+            d = d * 18446744073709551616.0 + limb[i - 1];
+        }
+        return d;
+    }
+
+    /**
+     * 10進表記の文字列を返す.
+     */
+    std::string toString() const {
+        if (limb.empty()) return "0";
+
+        // 10^19 で割った余りを下の桁から求める
+        uint64_t const BASE = 10000000000000000000ULL;
+        std::vector<uint64_t> q = limb;
+        std::vector<uint64_t> digits;
+        while (!q.empty()) {
+            unsigned __int128 r = 0;
+            for (size_t i = q.size(); i > 0; --i) {
+                unsigned __int128 const x = (r << 64) | q[i - 1];
+                q[i - 1] = static_cast<uint64_t>(x / BASE);
+                r = x % BASE;
+            }
+            digits.push_back(static_cast<uint64_t>(r));
+            while (!q.empty() && q.back() == 0) {
+                q.pop_back();
+            }
+        }
+
+        std::string s = std::to_string(digits.back());
+        for (size_t i = digits.size() - 1; i > 0; --i) {
+            std::string d = std::to_string(digits[i - 1]);
+            s.append(19 - d.size(), '0');
+            s += d;
+        }
+        return s;
+    }
+
+private:
+    void normalize() {
+        while (!limb.empty() && limb.back() == 0) {
+            limb.pop_back();
+        }
+    }
+
+public:
+    friend std::ostream& operator<<(std::ostream& os, BigNumber const& o) {
+        return os << o.toString();
+    }
+};
+
+#endif /* BIGNUMBER_HPP_ */
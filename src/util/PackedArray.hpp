@@ -0,0 +1,264 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: PackedArray.hpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#ifndef PACKEDARRAY_HPP_
+#define PACKEDARRAY_HPP_
+
+#include "TdZddHash.hpp"
+#include "TdZddPool.hpp"
+#include "util/ShiftedArray.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <stdint.h>
+
+/**
+ * 各要素を B ビットに詰めて持つ, 添字の範囲をずらせる配列.
+ * ShiftedArray と同じ使い方ができ, 最大 N 要素を64ビット語の列に収める.
+ * 要素は常に最小の添字を先頭に詰めて置き, 範囲外のビットは0に保つので,
+ * 同じ内容の配列はビット列として等しく, 比較は語ごとの整数比較で済む.
+ *
+ * R が偽なら要素は 2^B を法とする非負の値として格納する.
+ * R が真なら要素 x を添字 i からの相対位置 x - i で格納する (x = 0 は特別扱い).
+ * 相対位置の絶対値は 2^(B-1) 未満でなければならない.
+ * @tparam Data 要素の型.
+ * @tparam B 要素あたりのビット数. 64 の約数.
+ * @tparam N 要素数の上限.
+ * @tparam R 要素を相対位置で格納するか.
+ */
+template<typename Data, int B, int N, bool R = false>
+class PackedArray {
+    static_assert(64 % B == 0, "PackedArray: B must divide 64");
+    static_assert(N >= 1, "PackedArray: N must be positive");
+
+    static int const K = (B * N + 63) / 64; // number of words
+    static int const E = 64 / B;            // elements per word
+    static uint64_t const MASK = (B == 64) ? ~uint64_t(0) : (uint64_t(1) << (B % 64)) - 1;
+    static int const BIAS = R ? (1 << (B - 1)) : 0;
+
+    int vmin;           // minimum virtual index
+    int vmax;           // maximum virtual index
+    uint64_t word[K];   // packed elements; element vmin is at the lowest bits
+
+    uint64_t code(int index) const {
+        int const k = index - vmin;
+        return (word[k / E] >> (k % E * B)) & MASK;
+    }
+
+    void setCode(int index, uint64_t c) {
+        int const k = index - vmin;
+        int const s = k % E * B;
+        uint64_t& w = word[k / E];
+        w = (w & ~(MASK << s)) | ((c & MASK) << s);
+    }
+
+    Data get(int index) const {
+        uint64_t const c = code(index);
+        if (!R) return Data(c);
+        return (c == 0) ? Data(0) : Data(index + int(c) - BIAS);
+    }
+
+    void set(int index, Data x) {
+        if (!R) {
+            setCode(index, uint64_t(x));
+        }
+        else if (x == 0) {
+            setCode(index, 0);
+        }
+        else {
+            assert(-BIAS < int(x) - index && int(x) - index < BIAS);
+            setCode(index, uint64_t(int(x) - index + BIAS));
+        }
+    }
+
+    /**
+     * 要素を n 個ぶん先頭側へずらし, 空いた末尾を0で埋める.
+     */
+    void shift(int n) {
+        int const q = n / E;
+        int const s = n % E * B;
+        for (int k = 0; k < K; ++k) {
+            uint64_t const lo = (k + q < K) ? word[k + q] : 0;
+            uint64_t const hi = (k + q + 1 < K) ? word[k + q + 1] : 0;
+            word[k] = (s == 0) ? lo : (lo >> s) | (hi << (64 - s));
+        }
+    }
+
+public:
+    /**
+     * 要素への参照. 代入と前置の増減を要素の符号化に合わせて行う.
+     */
+    class Reference {
+        PackedArray& a;
+        int const index;
+
+    public:
+        Reference(PackedArray& a, int index)
+                : a(a), index(index) {
+        }
+
+        operator Data() const {
+            return a.get(index);
+        }
+
+        Reference& operator=(Data x) {
+            a.set(index, x);
+            return *this;
+        }
+
+        Reference& operator=(Reference const& o) {
+            a.set(index, Data(o));
+            return *this;
+        }
+
+        /**
+         * 1増やす. 戻り値は格納前の値に1を足したもので, 2^B で丸めない.
+         */
+        Data operator++() {
+            Data const x = a.get(index) + 1;
+            a.set(index, x);
+            return x;
+        }
+
+        /**
+         * 1減らす. 戻り値は格納前の値から1を引いたもので, 負にもなる.
+         */
+        Data operator--() {
+            Data const x = a.get(index) - 1;
+            a.set(index, x);
+            return x;
+        }
+    };
+
+    PackedArray(int psize, int vmin, int vmax)
+            : vmin(vmin), vmax(vmax) {
+        if (psize > N) throw std::runtime_error(
+                "PackedArray: Physical size exceeds the fixed size");
+        assert(psize >= 1);
+        assert(vmin <= vmax + 1);
+        assert(vmax - vmin + 1 <= psize);
+        std::memset(word, 0, sizeof(word));
+    }
+
+    PackedArray(PackedArray const& o, TdZddPool& pool)
+            : vmin(o.vmin), vmax(o.vmax) {
+        std::memcpy(word, o.word, sizeof(word));
+    }
+
+    bool hasIndex(int index) const {
+        return vmin <= index && index <= vmax;
+    }
+
+    int minIndex() const {
+        return vmin;
+    }
+
+    int maxIndex() const {
+        return vmax;
+    }
+
+    size_t size() const {
+        return vmax - vmin + 1;
+    }
+
+    void setMinIndex(int n) {
+        assert(vmin <= n);
+        if (n > vmax) {
+            std::memset(word, 0, sizeof(word));
+            vmin = n;
+            vmax = n - 1;
+        }
+        else if (n > vmin) {
+            shift(n - vmin);
+            vmin = n;
+        }
+    }
+
+    void setMaxIndex(int n) {
+        assert(vmax <= n);
+        assert(n - vmin < N);
+        vmax = n;
+    }
+
+    Reference operator[](int index) {
+        assert(vmin <= index && index <= vmax);
+        return Reference(*this, index);
+    }
+
+    Data operator[](int index) const {
+        assert(vmin <= index && index <= vmax);
+        return get(index);
+    }
+
+    size_t hashCode() const {
+        return hashBytes(word, sizeof(word), vmin);
+    }
+
+    bool equals(PackedArray const& o) const {
+        if (vmin != o.vmin) return false;
+        if (vmax != o.vmax) return false;
+        for (int k = 0; k < K; ++k) {
+            if (word[k] != o.word[k]) return false;
+        }
+        return true;
+    }
+
+    /**
+     * 添字の範囲と詰めた語の列をバイナリで書き出す.
+     */
+    void save(std::ostream& os) const {
+        os.write(reinterpret_cast<char const*>(&vmin), sizeof(vmin));
+        os.write(reinterpret_cast<char const*>(&vmax), sizeof(vmax));
+        os.write(reinterpret_cast<char const*>(word), sizeof(word));
+    }
+
+    /**
+     * save() で書き出した内容を読み込む.
+     * 添字の範囲が固定サイズに収まらなければ例外を投げる.
+     */
+    void load(std::istream& is) {
+        is.read(reinterpret_cast<char*>(&vmin), sizeof(vmin));
+        is.read(reinterpret_cast<char*>(&vmax), sizeof(vmax));
+        if (!is) throw std::runtime_error("PackedArray: Read error");
+        long long const size = static_cast<long long>(vmax) - vmin + 1;
+        if (size < 0 || size > N) throw std::runtime_error(
+                "PackedArray: Index range exceeds the fixed size");
+        is.read(reinterpret_cast<char*>(word), sizeof(word));
+        if (!is) throw std::runtime_error("PackedArray: Read error");
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, PackedArray const& o) {
+        os << "[";
+        for (int i = o.vmin; i <= o.vmax; ++i) {
+            os << "(" << i << "," << o.get(i) << ")";
+        }
+        return os << "]";
+    }
+};
+
+/**
+ * フィルタの状態の配列の型を選ぶ.
+ * 幅 W が0なら実行時に大きさを決める ShiftedArray を,
+ * 正なら要素を B ビットに詰めた PackedArray を使う.
+ * @tparam Data 要素の型.
+ * @tparam W 配列の物理サイズ. 0 なら実行時に決める.
+ * @tparam B 詰める場合の要素あたりのビット数.
+ * @tparam R 詰める場合に要素を相対位置で格納するか.
+ */
+template<typename Data, int W, int B, bool R = false>
+struct StateArray {
+    typedef PackedArray<Data,B,W,R> Type;
+};
+
+template<typename Data, int B, bool R>
+struct StateArray<Data,0,B,R> {
+    typedef ShiftedArray<Data,0> Type;
+};
+
+#endif /* PACKEDARRAY_HPP_ */
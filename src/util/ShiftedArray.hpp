@@ -8,13 +8,141 @@
 #ifndef SHIFTEDARRAY_HPP_
 #define SHIFTEDARRAY_HPP_
 
+#include "TdZddHash.hpp"
 #include "TdZddPool.hpp"
 
 #include <cassert>
 #include <cstring>
+#include <iostream>
+#include <stdexcept>
 
-template<typename Data>
+/**
+ * 添字の範囲をずらせる配列.
+ * N が正なら物理サイズ N の配列を自身の中に持ち, 複製時に別の領域を確保しない.
+ * 状態をプールに複製するフィルタでは, ポインタをたどらずに済む分だけ速い.
+ * N が0なら物理サイズを実行時に決め, 配列を別に確保する (下の特殊化).
+ */
+template<typename Data, int N = 0>
 class ShiftedArray {
+    int vmin;           // minimum virtual index
+    int vmax;           // maximum virtual index
+    int base;           // virtual index of parray[0]
+    Data parray[N];     // physical array
+
+    ShiftedArray(ShiftedArray const&);
+    ShiftedArray& operator=(ShiftedArray const&);
+
+public:
+    ShiftedArray(int psize, int vmin, int vmax)
+            : vmin(vmin), vmax(vmax), base(vmin) {
+        if (psize > N) throw std::runtime_error(
+                "ShiftedArray: Physical size exceeds the fixed size");
+        assert(psize >= 1);
+        assert(vmin <= vmax + 1);
+        assert(vmax - vmin + 1 <= psize);
+    }
+
+    ShiftedArray(ShiftedArray const& o, TdZddPool& pool)
+            : vmin(o.vmin), vmax(o.vmax), base(o.vmin) {
+        std::memcpy(parray, o.parray + (o.vmin - o.base),
+                (vmax - vmin + 1) * sizeof(Data));
+    }
+
+    bool hasIndex(int index) const {
+        return vmin <= index && index <= vmax;
+    }
+
+    int minIndex() const {
+        return vmin;
+    }
+
+    int maxIndex() const {
+        return vmax;
+    }
+
+    size_t size() const {
+        return vmax - vmin + 1;
+    }
+
+    void setMinIndex(int n) {
+        assert(vmin <= n);
+        vmin = n;
+        if (vmin > vmax) {
+            vmax = vmin - 1;
+            base = vmin;
+        }
+    }
+
+    void setMaxIndex(int n) {
+        assert(vmax <= n);
+        if (n - base >= N) {
+            std::memmove(parray, parray + (vmin - base),
+                    (vmax - vmin + 1) * sizeof(Data));
+            base = vmin;
+            assert(n - base < N);
+        }
+        vmax = n;
+    }
+
+    Data& operator[](int index) {
+        assert(vmin <= index && index <= vmax);
+        return parray[index - base];
+    }
+
+    Data operator[](int index) const {
+        assert(vmin <= index && index <= vmax);
+        return parray[index - base];
+    }
+
+    size_t hashCode() const {
+        return hashBytes(parray + (vmin - base),
+                (vmax - vmin + 1) * sizeof(Data), vmin);
+    }
+
+    bool equals(ShiftedArray const& o) const {
+        if (vmin != o.vmin) return false;
+        if (vmax != o.vmax) return false;
+        return std::memcmp(parray + (vmin - base), o.parray + (vmin - o.base),
+                (vmax - vmin + 1) * sizeof(Data)) == 0;
+    }
+
+    /**
+     * 添字の範囲と内容をバイナリで書き出す. 可変長の場合と同じ形式.
+     */
+    void save(std::ostream& os) const {
+        os.write(reinterpret_cast<char const*>(&vmin), sizeof(vmin));
+        os.write(reinterpret_cast<char const*>(&vmax), sizeof(vmax));
+        os.write(reinterpret_cast<char const*>(parray + (vmin - base)),
+                (vmax - vmin + 1) * sizeof(Data));
+    }
+
+    /**
+     * save() で書き出した内容を読み込む.
+     * 添字の範囲が固定サイズに収まらなければ例外を投げる.
+     */
+    void load(std::istream& is) {
+        is.read(reinterpret_cast<char*>(&vmin), sizeof(vmin));
+        is.read(reinterpret_cast<char*>(&vmax), sizeof(vmax));
+        if (!is) throw std::runtime_error("ShiftedArray: Read error");
+        long long const size = static_cast<long long>(vmax) - vmin + 1;
+        if (size < 0 || size > N) throw std::runtime_error(
+                "ShiftedArray: Index range exceeds the fixed size");
+        base = vmin;
+        is.read(reinterpret_cast<char*>(parray), size * sizeof(Data));
+        if (!is) throw std::runtime_error("ShiftedArray: Read error");
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, ShiftedArray const& o) {
+        os << "[";
+        for (int i = o.vmin; i <= o.vmax; ++i) {
+            os << "(" << i << "," << o[i] << ")";
+        }
+        return os << "]";
+    }
+};
+
+template<typename Data>
+class ShiftedArray<Data,0> {
     int const psize;    // physical array size
     Data* parray;       // physical array pointer
     bool toBeDeleted;   // need to delete parray
@@ -43,7 +171,7 @@ public:
                 (vmax - vmin + 1) * sizeof(Data));
     }
 
-    virtual ~ShiftedArray() {
+    ~ShiftedArray() {
         if (toBeDeleted) delete[] parray;
         parray = 0;
     }
@@ -100,20 +228,40 @@ public:
     }
 
     size_t hashCode() const {
-        size_t h = vmin;
-        for (int i = vmin; i <= vmax; ++i) {
-            h = h * 31 + varray[i];
-        }
-        return h;
+        return hashBytes(varray + vmin, (vmax - vmin + 1) * sizeof(Data), vmin);
     }
 
     bool equals(ShiftedArray const& o) const {
         if (vmin != o.vmin) return false;
         if (vmax != o.vmax) return false;
-        for (int i = vmin; i <= vmax; ++i) {
-            if (varray[i] != o.varray[i]) return false;
-        }
-        return true;
+        return std::memcmp(varray + vmin, o.varray + vmin,
+                (vmax - vmin + 1) * sizeof(Data)) == 0;
+    }
+
+    /**
+     * 添字の範囲と内容をバイナリで書き出す.
+     */
+    void save(std::ostream& os) const {
+        os.write(reinterpret_cast<char const*>(&vmin), sizeof(vmin));
+        os.write(reinterpret_cast<char const*>(&vmax), sizeof(vmax));
+        os.write(reinterpret_cast<char const*>(varray + vmin),
+                (vmax - vmin + 1) * sizeof(Data));
+    }
+
+    /**
+     * save() で書き出した内容を読み込む. 物理サイズは書き出し元と同じであること.
+     * 添字の範囲が物理サイズに収まらなければ例外を投げる.
+     */
+    void load(std::istream& is) {
+        is.read(reinterpret_cast<char*>(&vmin), sizeof(vmin));
+        is.read(reinterpret_cast<char*>(&vmax), sizeof(vmax));
+        if (!is) throw std::runtime_error("ShiftedArray: Read error");
+        long long const size = static_cast<long long>(vmax) - vmin + 1;
+        if (size < 0 || size > psize) throw std::runtime_error(
+                "ShiftedArray: Index range exceeds the physical size");
+        varray = parray - vmin;
+        is.read(reinterpret_cast<char*>(parray), size * sizeof(Data));
+        if (!is) throw std::runtime_error("ShiftedArray: Read error");
     }
 
     friend std::ostream& operator<<(std::ostream& os, ShiftedArray const& o) {
@@ -0,0 +1,29 @@
+/*
+ * Top-Down ZDD Builder
+ * Hiroaki Iwashita <iwashita@erato.ist.hokudai.ac.jp>
+ * Copyright (c) 2011 Japan Science and Technology Agency
+ * $Id: StateWidth.hpp 9 2011-11-16 06:38:04Z iwashita $
+ */
+
+#ifndef STATEWIDTH_HPP_
+#define STATEWIDTH_HPP_
+
+/**
+ * 状態の配列の幅を固定したフィルタの実体を選ぶ.
+ * フィルタの .cpp で実体化している幅 8, 16, 24, 32 のうち width 以上で
+ * 最小のものを W として f.run<W>() を呼ぶ. 32 を超える場合は W = 0 とし,
+ * 幅を実行時に決める実体を使う.
+ * @param width 必要な配列の幅.
+ * @param f template<int W> run() const を持つ関数オブジェクト.
+ * @return f.run<W>() の戻り値.
+ */
+template<typename F>
+auto dispatchStateWidth(int width, F const& f) -> decltype(f.template run<0>()) {
+    if (width <= 8) return f.template run<8>();
+    if (width <= 16) return f.template run<16>();
+    if (width <= 24) return f.template run<24>();
+    if (width <= 32) return f.template run<32>();
+    return f.template run<0>();
+}
+
+#endif /* STATEWIDTH_HPP_ */
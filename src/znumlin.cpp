@@ -6,22 +6,32 @@
  */
 
 #include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
-#include <set>
+#include <sstream>
 #include <string>
+#include <tuple>
 
 #include "TdZdd.hpp"
+#include "TdZddCounter.hpp"
+#include "TdZddFrozen.hpp"
+#include "TdZddIndex.hpp"
 
 #include "filter/AND.hpp"
 #include "filter/Degree0or2.hpp"
 #include "filter/Degree2.hpp"
 #include "filter/NumlinFilter.hpp"
 #include "filter/NumOfItems.hpp"
+#include "filter/NumOfPaths.hpp"
 #include "graph/NumlinQuiz.hpp"
+#include "util/BigNumber.hpp"
 #include "util/MessageHandler.hpp"
+#include "util/StateWidth.hpp"
 
 void usage(char const* cmd) {
     std::cerr << "usage: " << cmd << " <option>... <quiz_file>\n";
@@ -30,12 +40,184 @@ void usage(char const* cmd) {
     std::cerr << "  -graph:    Dump input graph to STDOUT in DOT format\n";
     std::cerr << "  -dump:     Dump result ZDD to STDOUT in DOT format\n";
     std::cerr << "  -noreport: Do not print final report\n";
+    std::cerr << "  -mp:       Use multiple processors\n";
+    std::cerr << "  -unordered: Print solutions in any order with -mp\n";
+    std::cerr << "  -save <file>: Save result ZDD to <file>\n";
+    std::cerr << "  -load <file>: Load result ZDD from <file> instead of solving\n";
+    std::cerr << "  -count:    Count solutions without building ZDD\n";
+    std::cerr << "  -exact:    Print the exact number of solutions\n";
+    std::cerr << "  -range <k> <m>: Print <m> solutions from #<k> (0-origin)\n";
+    std::cerr << "  -checkpoint <file>: Save progress to <file> every 10 minutes\n";
+    std::cerr << "  -checkpoint-sec <t>: Save progress every <t> seconds\n";
+    std::cerr << "  -checkpoint-lev <n>: Save progress every <n> levels\n";
+    std::cerr << "  -resume <file>: Resume solving from checkpoint <file>\n";
+    std::cerr << "  -spill <dir>: Spill pending states of later levels to <dir>\n";
+    std::cerr << "  -block <KB>: Set memory pool block size to <KB> kilobytes\n";
+    std::cerr << "  -budget <MB>: Abort solving if memory pools would exceed <MB>\n";
+    std::cerr << "  -hugepage: Back memory pool blocks with huge pages if possible\n";
+    std::cerr << "  -order <method>: Number vertices by <method>"
+            " (given, bfs, cm, greedy, auto)\n";
 }
 
+/// 保存するZDDのメタデータの先頭行. 続けて入力ファイルの内容を置く.
+/// 頂点の番号付けを変えた場合は間に orderTag で始まる行を置く.
+std::string const metaTag = "znumlin\n";
+std::string const orderTag = "order ";
+
 void dump(std::ostream& os, TdZdd const& dd, Graph const& g) {
     dd.dump(os, [g](int i) {return g.arcName(i);});
 }
 
+void dump(std::ostream& os, TdZddFrozen const& dd, Graph const& g) {
+    dd.dump(os, [g](int i) {return g.arcName(i);});
+}
+
+/**
+ * 状態の幅を W に固定したフィルタで解の数を数える.
+ * mate を詰めるビット数 B は頂点数から選ぶ.
+ */
+struct CountSolutions {
+    NumlinQuiz const& g;
+    TdZddCounter& counter;
+    bool opt_kansai;
+
+    template<int W>
+    BigNumber run() const {
+        if (W == 0 || g.vertexSize() <= 128) return count<W,8>();
+        if (g.vertexSize() <= 32768) return count<W,16>();
+        return count<0,8>();
+    }
+
+    template<int W, int B>
+    BigNumber count() const {
+        int const n = g.arcSize();
+        if (opt_kansai) {
+            BasicDegree0or2<W> f1(g);
+            BasicNumlinFilter<W,B> f2(g);
+            return counter.count(
+                    AND<BasicDegree0or2<W>,BasicNumlinFilter<W,B>>(n, f1, f2));
+        }
+        else {
+            BasicDegree2<W> f1(g);
+            BasicNumlinFilter2<W,B> f2(g);
+            return counter.count(
+                    AND<BasicDegree2<W>,BasicNumlinFilter2<W,B>>(n, f1, f2));
+        }
+    }
+};
+
+/**
+ * 状態の幅を W に固定したフィルタで解のZDDを構築する.
+ * mate を詰めるビット数 B は頂点数から選ぶ.
+ */
+struct Solve {
+    NumlinQuiz const& g;
+    TdZdd& dd;
+    MessageHandler& mh;
+    bool opt_kansai;
+    bool opt_0;
+    bool opt_1;
+    bool opt_dump1;
+    bool opt_dump2;
+    bool opt_dump3;
+
+    template<int W>
+    void run() const {
+        if (W == 0 || g.vertexSize() <= 128) return solve<W,8>();
+        if (g.vertexSize() <= 32768) return solve<W,16>();
+        return solve<0,8>();
+    }
+
+    template<int W, int B>
+    void solve() const {
+        typedef BasicDegree0or2<W> Degree0or2;
+        typedef BasicDegree2<W> Degree2;
+        typedef BasicNumlinFilter<W,B> NumlinFilter;
+        typedef BasicNumlinFilter2<W,B> NumlinFilter2;
+        int const n = g.arcSize();
+
+        if (opt_0) {
+            if (opt_kansai) {
+                mh.begin("NumlinFilter") << " ...";
+                dd.subset(NumlinFilter(g));
+                mh.end(dd.size());
+            }
+            else {
+                mh.begin("NumlinFilter2") << " ...";
+                dd.subset(NumlinFilter2(g));
+                mh.end(dd.size());
+            }
+
+            if (opt_dump1) dump(std::cout, dd, g);
+
+            mh.begin("reduction") << " ...";
+            dd.reduce();
+            mh.end(dd.size());
+        }
+        else if (opt_1) {
+            if (opt_kansai) {
+                mh.begin("Degree0or2 & NumlinFilter") << " ...";
+                Degree0or2 f1(g);
+                NumlinFilter f2(g);
+                AND<Degree0or2,NumlinFilter> filter(n, f1, f2);
+                dd.subset(filter);
+                mh.end(dd.size());
+            }
+            else {
+                mh.begin("Degree2 & NumlinFilter2") << " ...";
+                Degree2 f1(g);
+                NumlinFilter2 f2(g);
+                AND<Degree2,NumlinFilter2> filter(n, f1, f2);
+                dd.subset(filter);
+                mh.end(dd.size());
+            }
+
+            if (opt_dump1) dump(std::cout, dd, g);
+
+            mh.begin("reduction") << " ...";
+            dd.reduce();
+            mh.end(dd.size());
+        }
+        else {
+            if (opt_kansai) {
+                mh.begin("Degree0or2") << " ...";
+                dd.subset(Degree0or2(g));
+                mh.end(dd.size());
+            }
+            else {
+                mh.begin("Degree2") << " ...";
+                dd.subset(Degree2(g));
+                mh.end(dd.size());
+            }
+
+            if (opt_dump1) dump(std::cout, dd, g);
+
+            mh.begin("reduction") << " ...";
+            dd.reduce();
+            mh.end(dd.size());
+
+            if (opt_dump2) dump(std::cout, dd, g);
+
+            if (opt_kansai) {
+                mh.begin("NumlinFilter") << " ...";
+                dd.subset(NumlinFilter(g));
+                mh.end(dd.size());
+            }
+            else {
+                mh.begin("NumlinFilter2") << " ...";
+                dd.subset(NumlinFilter2(g));
+                mh.end(dd.size());
+            }
+
+            if (opt_dump3) dump(std::cout, dd, g);
+
+            mh.begin("reduction") << " ...";
+            dd.reduce();
+            mh.end(dd.size());
+        }
+    }
+};
+
 int main(int argc, char *argv[]) {
     std::string filename;
     bool opt_kansai = false;
@@ -47,6 +229,24 @@ int main(int argc, char *argv[]) {
     bool opt_dump2 = false;
     bool opt_dump3 = false;
     bool opt_noreport = false;
+    bool opt_mp = false;
+    bool opt_unordered = false;
+    bool opt_count = false;
+    bool opt_exact = false;
+    bool opt_range = false;
+    uint64_t opt_range_from = 0;
+    uint64_t opt_range_size = 0;
+    std::string opt_save;
+    std::string opt_load;
+    std::string opt_checkpoint;
+    double opt_checkpoint_sec = 600;
+    int opt_checkpoint_lev = 0;
+    std::string opt_resume;
+    std::string opt_spill;
+    size_t opt_block = 0;
+    size_t opt_budget = 0;
+    bool opt_hugepage = false;
+    Graph::Ordering opt_order = Graph::AS_GIVEN;
 
     for (int i = 1; i < argc; ++i) {
         std::string s = argv[i];
@@ -82,6 +282,63 @@ int main(int argc, char *argv[]) {
             else if (s == "-noreport") {
                 opt_noreport = true;
             }
+            else if (s == "-mp") {
+                opt_mp = true;
+            }
+            else if (s == "-unordered") {
+                opt_unordered = true;
+            }
+            else if (s == "-count") {
+                opt_count = true;
+            }
+            else if (s == "-exact") {
+                opt_exact = true;
+            }
+            else if (s == "-range" && i + 2 < argc) {
+                opt_range = true;
+                opt_range_from = std::strtoull(argv[++i], 0, 10);
+                opt_range_size = std::strtoull(argv[++i], 0, 10);
+            }
+            else if (s == "-save" && i + 1 < argc) {
+                opt_save = argv[++i];
+            }
+            else if (s == "-load" && i + 1 < argc) {
+                opt_load = argv[++i];
+            }
+            else if (s == "-checkpoint" && i + 1 < argc) {
+                opt_checkpoint = argv[++i];
+            }
+            else if (s == "-checkpoint-sec" && i + 1 < argc) {
+                opt_checkpoint_sec = std::atof(argv[++i]);
+                opt_checkpoint_lev = 0;
+            }
+            else if (s == "-checkpoint-lev" && i + 1 < argc) {
+                opt_checkpoint_lev = std::atoi(argv[++i]);
+                opt_checkpoint_sec = 0;
+            }
+            else if (s == "-resume" && i + 1 < argc) {
+                opt_resume = argv[++i];
+            }
+            else if (s == "-spill" && i + 1 < argc) {
+                opt_spill = argv[++i];
+            }
+            else if (s == "-block" && i + 1 < argc) {
+                opt_block = std::strtoul(argv[++i], 0, 10) * 1024;
+                if (opt_block == 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+            }
+            else if (s == "-budget" && i + 1 < argc) {
+                opt_budget = std::strtoul(argv[++i], 0, 10) << 20;
+            }
+            else if (s == "-hugepage") {
+                opt_hugepage = true;
+            }
+            else if (s == "-order" && i + 1 < argc
+                    && Graph::parseOrdering(argv[i + 1], opt_order)) {
+                ++i;
+            }
             else {
                 usage(argv[0]);
                 return 1;
@@ -96,6 +353,11 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if (opt_block > 0 || opt_hugepage) {
+        TdZddPool::configure(opt_block > 0 ? opt_block : TdZddPool::blockSize(),
+                opt_hugepage);
+    }
+
     MessageHandler m0;
     m0.begin("started");
 
@@ -103,9 +365,41 @@ int main(int argc, char *argv[]) {
     m1.begin("reading");
 
     NumlinQuiz g;
-    if (filename.empty()) {
+    TdZddFrozen zdd;
+    std::string input;
+    if (!opt_load.empty()) {
+        m1 << " \"" << opt_load << "\" ...";
+        try {
+            zdd.load(opt_load);
+        }
+        catch (std::exception const& e) {
+            m1 << " " << e.what() << "\n";
+            return 1;
+        }
+        zdd.useMultiProcessors(opt_mp);
+        input = zdd.metadata();
+        if (input.compare(0, metaTag.size(), metaTag) != 0) {
+            m1 << " Not a znumlin result\n";
+            return 1;
+        }
+        input.erase(0, metaTag.size());
+        if (input.compare(0, orderTag.size(), orderTag) == 0) {
+            size_t const eol = input.find('\n');
+            std::string const name = input.substr(orderTag.size(),
+                    eol - orderTag.size());
+            if (eol == std::string::npos
+                    || !Graph::parseOrdering(name, opt_order)) {
+                m1 << " Broken metadata\n";
+                return 1;
+            }
+            input.erase(0, eol + 1);
+        }
+    }
+    else if (filename.empty()) {
         m1 << " STDIN ...";
-        g.readQuiz(std::cin);
+        std::ostringstream oss;
+        oss << std::cin.rdbuf();
+        input = oss.str();
     }
     else {
         m1 << " \"" << filename << "\" ...";
@@ -114,124 +408,138 @@ int main(int argc, char *argv[]) {
             m1 << " " << strerror(errno) << "\n";
             return 1;
         }
-        g.readQuiz(fin);
+        std::ostringstream oss;
+        oss << fin.rdbuf();
+        input = oss.str();
     }
+    std::istringstream iss(input);
+    g.setOrdering(opt_order);
+    g.readQuiz(iss);
 
     m1.end();
     if (g.arcSize() == 0) {
         m1 << "ERROR: Empty input\n";
         return 1;
     }
+    if (!opt_load.empty() && zdd.variables() != int(g.arcSize())) {
+        m1 << "ERROR: ZDD does not match the quiz\n";
+        return 1;
+    }
+    m1 << "#frontier = " << g.maxFrontierSize() << " ("
+            << Graph::orderingName(opt_order) << " order)\n";
 
     if (opt_graph) {
         std::cout << g;
         return 0;
     }
 
-    {
+    if (opt_count && opt_load.empty()) {
         int const n = g.arcSize();
-        TdZdd dd(n);
-        MessageHandler mh;
+        TdZddCounter counter(n);
 
-        m1.begin("solving") << " ...";
-        if (opt_0) {
-            if (opt_kansai) {
-                mh.begin("NumlinFilter") << " ...";
-                dd.subset(NumlinFilter(g));
-                mh.end(dd.size());
-            }
-            else {
-                mh.begin("NumlinFilter2") << " ...";
-                dd.subset(NumlinFilter2(g));
-                mh.end(dd.size());
-            }
+        m1.begin("counting") << " ...";
+        CountSolutions counting = { g, counter, opt_kansai };
+        BigNumber count = dispatchStateWidth(g.maxFrontierSize(), counting);
+        m1.end(counter.peakStates());
 
-            if (opt_dump1) dump(std::cout, dd, g);
+        m0 << "#solution = " << count << "\n";
+        m0.end("finished");
+        return 0;
+    }
 
-            mh.begin("reduction") << " ...";
-            dd.reduce();
-            mh.end(dd.size());
-        }
-        else if (opt_1) {
-            if (opt_kansai) {
-                mh.begin("Degree0or2 & NumlinFilter") << " ...";
-                Degree0or2 f1(g);
-                NumlinFilter f2(g);
-                AND<Degree0or2,NumlinFilter> filter(n, f1, f2);
-                dd.subset(filter);
-                mh.end(dd.size());
+    if (opt_load.empty()) {
+        int const n = g.arcSize();
+        TdZdd dd(n);
+        dd.useMultiProcessors(opt_mp);
+        dd.setCheckpoint(opt_checkpoint, opt_checkpoint_lev,
+                opt_checkpoint_sec);
+        dd.setMemoryBudget(opt_budget);
+        dd.setSpillDirectory(opt_spill);
+        if (!opt_resume.empty()) {
+            try {
+                dd.resume(opt_resume);
             }
-            else {
-                mh.begin("Degree2 & NumlinFilter2") << " ...";
-                Degree2 f1(g);
-                NumlinFilter2 f2(g);
-                AND<Degree2,NumlinFilter2> filter(n, f1, f2);
-                dd.subset(filter);
-                mh.end(dd.size());
+            catch (std::exception const& e) {
+                m1 << "ERROR: " << e.what() << "\n";
+                return 1;
             }
-
-            if (opt_dump1) dump(std::cout, dd, g);
-
-            mh.begin("reduction") << " ...";
-            dd.reduce();
-            mh.end(dd.size());
         }
-        else {
-            if (opt_kansai) {
-                mh.begin("Degree0or2") << " ...";
-                dd.subset(Degree0or2(g));
-                mh.end(dd.size());
-            }
-            else {
-                mh.begin("Degree2") << " ...";
-                dd.subset(Degree2(g));
-                mh.end(dd.size());
-            }
-
-            if (opt_dump1) dump(std::cout, dd, g);
+        MessageHandler mh;
 
-            mh.begin("reduction") << " ...";
-            dd.reduce();
-            mh.end(dd.size());
+        m1.begin("solving") << " ...";
+        Solve solve = { g, dd, mh, opt_kansai, opt_0, opt_1, opt_dump1,
+                opt_dump2, opt_dump3 };
+        try {
+            dispatchStateWidth(g.maxFrontierSize(), solve);
+        }
+        catch (std::exception const& e) {
+            m1 << "\nERROR: " << e.what() << "\n";
+            return 1;
+        }
+        m1.end();
 
-            if (opt_dump2) dump(std::cout, dd, g);
+#ifdef DEBUG
+        dd.printDebugInfo(std::cerr);
+#endif
 
-            if (opt_kansai) {
-                mh.begin("NumlinFilter") << " ...";
-                dd.subset(NumlinFilter(g));
-                mh.end(dd.size());
+        if (!opt_save.empty()) {
+            mh.begin("saving") << " \"" << opt_save << "\" ...";
+            std::ofstream fout(opt_save, std::ios::out | std::ios::binary);
+            if (!fout) {
+                mh << " " << strerror(errno) << "\n";
+                return 1;
             }
-            else {
-                mh.begin("NumlinFilter2") << " ...";
-                dd.subset(NumlinFilter2(g));
-                mh.end(dd.size());
+            std::string meta = metaTag;
+            if (opt_order != Graph::AS_GIVEN) {
+                meta += orderTag + Graph::orderingName(opt_order) + "\n";
             }
+            dd.save(fout, meta + input);
+            mh.end();
+        }
 
-            if (opt_dump3) dump(std::cout, dd, g);
+        zdd = TdZddFrozen(dd, true);
+    }
 
-            mh.begin("reduction") << " ...";
-            dd.reduce();
-            mh.end(dd.size());
-        }
-        m1.end();
+    if (opt_dump) dump(std::cout, zdd, g);
 
-        if (opt_dump) dump(std::cout, dd, g);
+    if (!opt_noreport) {
+        // 長さと解の数は1回の走査でまとめて求める
+        NumOfItems::Range length;
+        double count;
+        std::tie(length, count) = zdd.evaluate(NumOfItems(), NumOfPaths());
+        m0 << "#node = " << zdd.size() << ", #solution = ";
+        if (opt_exact) {
+            m0 << zdd.exactPathCount();
+        }
+        else {
+            m0 << std::setprecision(6) << count;
+        }
+        m0 << ", length = [" << length.min << "," << length.max << "]\n";
 
-        if (!opt_noreport) {
-            auto length = dd.evaluate(NumOfItems());
-            m0 << "#node = " << dd.size() << ", #solution = "
-                    << std::setprecision(6) << dd.pathCount() << ", length = ["
-                    << length.min << "," << length.max << "]\n";
+        AnswerRenderer renderer = g.answerRenderer();
+        std::cout.flush();
 
-            for (auto p = dd.begin(); p != dd.end(); ++p) {
-                std::set<Graph::ArcNumber> answer(p->begin(), p->end());
-                g.printAnswer(std::cout, answer);
+        if (opt_range) {
+            // 番号の表を作れば, 途中の解から経路の長さに比例する時間で始められる
+            TdZddIndex index(zdd);
+            auto const e = index.end();
+            auto p = index.find(BigNumber(opt_range_from));
+            for (uint64_t j = 0; j < opt_range_size && p != e; ++j, ++p) {
+                renderer.write(stdout, *p);
             }
+            renderer.flush(stdout);
+        }
+        else if (opt_mp) {
+            TdZddIndex index(zdd);
+            index.useMultiProcessors();
+            index.print(std::cout, renderer, !opt_unordered);
+        }
+        else {
+            for (auto p = zdd.begin(); p != zdd.end(); ++p) {
+                renderer.write(stdout, *p);
+            }
+            renderer.flush(stdout);
         }
-
-#ifdef DEBUG
-        dd.printDebugInfo(std::cerr);
-#endif
     }
 
     m0.end("finished");
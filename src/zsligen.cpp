@@ -5,17 +5,23 @@
  * $Id: zsligen.cpp 9 2011-11-16 06:38:04Z iwashita $
  */
 
+#include <algorithm>
 #include <cerrno>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <random>
 #include <set>
 #include <string>
+#include <tuple>
 #include <typeinfo>
 
 #include "TdZdd.hpp"
+#include "TdZddSampler.hpp"
 
 #include "dd/cudd_BDD.hpp"
 #include "filter/DDBuilder.hpp"
@@ -26,6 +32,7 @@
 #include "filter/UnivAbstract.hpp"
 #include "filter/MinimalItems.hpp"
 #include "filter/NumOfItems.hpp"
+#include "filter/NumOfPaths.hpp"
 #include "filter/Simpath.hpp"
 //#include "filter/SlilinGen.hpp"
 #include "filter/ULNumOfItems.hpp"
@@ -54,6 +61,7 @@ bool opt_r = false;
 bool opt_csv = false;
 bool opt_tex = false;
 bool opt_noreport = false;
+uint64_t opt_seed = std::time(0);
 
 void usage(char const* cmd) {
     std::cerr << "usage: " << cmd << " <option>... <quiz_file>\n";
@@ -68,6 +76,7 @@ void usage(char const* cmd) {
     std::cerr << "  -r:   Rotate output right\n";
     std::cerr << "  -csv: Generate CSV\n";
     std::cerr << "  -tex: Generate LaTeX picture\n";
+    std::cerr << "  -seed <n>: Seed for random selection\n";
 }
 
 void dump(std::ostream& os, TdZdd const& dd, Graph const& g) {
@@ -624,6 +633,9 @@ int main(int argc, char *argv[]) {
             else if (s == "-noreport") {
                 opt_noreport = true;
             }
+            else if (s == "-seed" && i + 1 < argc) {
+                opt_seed = std::strtoull(argv[++i], 0, 10);
+            }
             else {
                 usage(argv[0]);
                 return 1;
@@ -773,10 +785,12 @@ int main(int argc, char *argv[]) {
     if (opt_dump2) dump(std::cout, dd, quiz);
 
     if (!opt_noreport) {
-        auto length = dd.evaluate(NumOfItems());
+        NumOfItems::Range length;
+        double count;
+        std::tie(length, count) = dd.evaluate(NumOfItems(), NumOfPaths());
         m0 << "#node = " << dd.size() << ", #cycle = " << std::setprecision(6)
-                << dd.pathCount() << ", length = [" << length.min << ","
-                << length.max << "]\n";
+                << count << ", length = [" << length.min << "," << length.max
+                << "]\n";
     }
 
     //slilinGen(SlilinGen1(quiz), dd);
@@ -786,14 +800,15 @@ int main(int argc, char *argv[]) {
     slilinGenByBDD(quiz, dd);
     //slilinGenByTdZdd(quiz, dd);
 
-    auto length = dd.evaluate(NumOfItems());
+    NumOfItems::Range length;
+    double pathCount;
+    std::tie(length, pathCount) = dd.evaluate(NumOfItems(), NumOfPaths());
     if (!opt_noreport) {
         mh << "#node = " << dd.size() << ", #puzzle = " << std::setprecision(6)
-                << dd.pathCount() << ", #hint = [" << length.min << ","
+                << pathCount << ", #hint = [" << length.min << ","
                 << length.max << "]\n";
     }
 
-    auto pathCount = dd.pathCount();
     if (pathCount < 1) {
         mh << "The puzzle has no solution.\n";
         return 1;
@@ -808,9 +823,11 @@ int main(int argc, char *argv[]) {
         mh.end(dd.size());
 
         if (!opt_noreport) {
-            auto length = dd.evaluate(NumOfItems());
+            NumOfItems::Range length;
+            double count;
+            std::tie(length, count) = dd.evaluate(NumOfItems(), NumOfPaths());
             mh << "#node = " << dd.size() << ", #puzzle = "
-                    << std::setprecision(6) << dd.pathCount() << ", #hint = ["
+                    << std::setprecision(6) << count << ", #hint = ["
                     << length.min << "," << length.max << "]\n";
         }
     }
@@ -821,50 +838,22 @@ int main(int argc, char *argv[]) {
         mh.end(dd.size());
 
         if (!opt_noreport) {
-            auto length = dd.evaluate(NumOfItems());
+            NumOfItems::Range length;
+            double count;
+            std::tie(length, count) = dd.evaluate(NumOfItems(), NumOfPaths());
             mh << "#node = " << dd.size() << ", #puzzle = "
-                    << std::setprecision(6) << dd.pathCount() << ", #hint = ["
+                    << std::setprecision(6) << count << ", #hint = ["
                     << length.min << "," << length.max << "]\n";
         }
     }
 
-    Score top;
-    int n;
-    if (opt_d) {
-        mh.begin("evaluating puzzle difficulty") << " ...";
-        n = 0;
-        for (auto p = dd.begin(); p != dd.end(); ++p) {
-            Score s;
-            for (auto q = p->begin(); q != p->end(); ++q) {
-                int y = *q / (quiz.cols() - 1);
-                int x = *q % (quiz.cols() - 1);
-                int h = quiz.hint(y, x);
-                s.add(h);
-            }
-
-            if (n == 0 || top < s) {
-                top = s;
-                n = 1;
-            }
-            else if (top == s) {
-                ++n;
-            }
-        }
-        mh << " " << top;
-        mh.end("(x" + std::to_string(n) + ")");
-    }
-    else {
-        n = dd.pathCount();
-    }
-
-    std::srand(std::time(0));
-    int r = std::rand() % n + 1;
-    int k = 0;
     int nx = quiz.cols() - 1;
     int ny = quiz.rows() - 1;
     if ((opt_csv || opt_tex) && (quiz.rotation() & 1)) std::swap(nx, ny);
 
-    for (auto p = dd.begin(); p != dd.end(); ++p) {
+    // 組合せからヒントの表を作り, 難易度を s に求める
+    auto makeHint = [&](std::vector<int> const& items, Score& s)
+            -> std::vector<std::vector<int>> {
         std::vector<std::vector<int>> hint(ny);
         for (int y = 0; y < ny; ++y) {
             hint[y].resize(nx);
@@ -873,10 +862,10 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        Score s;
-        for (auto q = p->begin(); q != p->end(); ++q) {
-            int row = *q / (quiz.cols() - 1);
-            int col = *q % (quiz.cols() - 1);
+        s = Score();
+        for (int q : items) {
+            int row = q / (quiz.cols() - 1);
+            int col = q % (quiz.cols() - 1);
             int v = quiz.hint(row, col);
             s.add(v);
 
@@ -896,79 +885,126 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        if (!opt_d || s == top) {
-            ++k;
-            if (opt_a) std::cout << "Quiz #" << k << ": " << s << "\n";
-
-            if (opt_a || k == r) {
-                if (opt_csv) {
-                    for (auto line : hint) {
-                        bool c = false;
-                        for (int v : line) {
-                            if (c) std::cout << ",";
-                            if (v >= 0) std::cout << v;
-                            c = true;
-                        }
-                        std::cout << "\n";
-                    }
+        return hint;
+    };
+
+    auto printHint = [&](std::vector<std::vector<int>> const& hint) {
+        if (opt_csv) {
+            for (auto line : hint) {
+                bool c = false;
+                for (int v : line) {
+                    if (c) std::cout << ",";
+                    if (v >= 0) std::cout << v;
+                    c = true;
                 }
-                else if (opt_tex) {
-                    std::cout << "\\begin{figure}\\centering\n"
-                            << "  \\setlength\\unitlength{" << 1.0 / double(nx)
-                            << "\\textwidth}\n"
-                            << "  \\linethickness{0.07\\unitlength}\n"
-                            << "  \\begin{picture}(" << nx << "," << ny
-                            << ")(0,0)\n";
-
-                    for (int y = 0; y <= ny; ++y) {
-                        std::cout << "    \\multiput(0," << ny - y << ")(1,0){"
-                                << nx + 1 << "}{\\circle*{0.2}}\n";
-                    }
-
-                    for (int y = 0; y < ny; ++y) {
-                        for (int x = 0; x < nx; ++x) {
-                            int v = hint[y][x];
-                            if (v < 0) continue;
-                            std::cout << "    \\put(" << x << "," << ny - y - 1
-                                    << "){\\makebox(1,1){" << v << "}}\n";
-                        }
-                    }
+                std::cout << "\n";
+            }
+        }
+        else if (opt_tex) {
+            std::cout << "\\begin{figure}\\centering\n"
+                    << "  \\setlength\\unitlength{" << 1.0 / double(nx)
+                    << "\\textwidth}\n"
+                    << "  \\linethickness{0.07\\unitlength}\n"
+                    << "  \\begin{picture}(" << nx << "," << ny
+                    << ")(0,0)\n";
+
+            for (int y = 0; y <= ny; ++y) {
+                std::cout << "    \\multiput(0," << ny - y << ")(1,0){"
+                        << nx + 1 << "}{\\circle*{0.2}}\n";
+            }
+
+            for (int y = 0; y < ny; ++y) {
+                for (int x = 0; x < nx; ++x) {
+                    int v = hint[y][x];
+                    if (v < 0) continue;
+                    std::cout << "    \\put(" << x << "," << ny - y - 1
+                            << "){\\makebox(1,1){" << v << "}}\n";
+                }
+            }
 
-                    for (int y = 0; y < ny; ++y) {
-                        for (int x = 0; x < nx; ++x) {
-                            if (quiz.northArcTaken(y, x)) {
-                                std::cout << "    \\put(" << x << "," << ny - y
-                                        << "){\\line(1,0){1}}\n";
-                            }
-                            if (quiz.westArcTaken(y, x)) {
-                                std::cout << "    \\put(" << x << "," << ny - y
-                                        << "){\\line(0,-1){1}}\n";
-                            }
-                        }
-                        if (quiz.westArcTaken(y, nx)) {
-                            std::cout << "    \\put(" << nx << "," << ny - y
-                                    << "){\\line(0,-1){1}}\n";
-                        }
+            for (int y = 0; y < ny; ++y) {
+                for (int x = 0; x < nx; ++x) {
+                    if (quiz.northArcTaken(y, x)) {
+                        std::cout << "    \\put(" << x << "," << ny - y
+                                << "){\\line(1,0){1}}\n";
                     }
-                    for (int x = 0; x < nx; ++x) {
-                        if (quiz.northArcTaken(ny, x)) {
-                            std::cout << "    \\put(" << x << "," << 0
-                                    << "){\\line(1,0){1}}\n";
-                        }
+                    if (quiz.westArcTaken(y, x)) {
+                        std::cout << "    \\put(" << x << "," << ny - y
+                                << "){\\line(0,-1){1}}\n";
                     }
-
-                    std::cout << "  \\end{picture}\n" << "\\end{figure}\n";
                 }
-                else {
-                    quiz.printQuiz(std::cout, hint);
+                if (quiz.westArcTaken(y, nx)) {
+                    std::cout << "    \\put(" << nx << "," << ny - y
+                            << "){\\line(0,-1){1}}\n";
                 }
-                if (!opt_a) break;
+            }
+            for (int x = 0; x < nx; ++x) {
+                if (quiz.northArcTaken(ny, x)) {
+                    std::cout << "    \\put(" << x << "," << 0
+                            << "){\\line(1,0){1}}\n";
+                }
+            }
+
+            std::cout << "  \\end{picture}\n" << "\\end{figure}\n";
+        }
+        else {
+            quiz.printQuiz(std::cout, hint);
+        }
+    };
+
+    Score top;
+    int n = 0;
+    if (opt_d) {
+        mh.begin("evaluating puzzle difficulty") << " ...";
+        for (auto p = dd.begin(); p != dd.end(); ++p) {
+            Score s;
+            for (auto q = p->begin(); q != p->end(); ++q) {
+                int y = *q / (quiz.cols() - 1);
+                int x = *q % (quiz.cols() - 1);
+                int h = quiz.hint(y, x);
+                s.add(h);
+            }
+
+            if (n == 0 || top < s) {
+                top = s;
+                n = 1;
+            }
+            else if (top == s) {
+                ++n;
             }
         }
+        mh << " " << top;
+        mh.end("(x" + std::to_string(n) + ")");
+    }
+
+    if (opt_a || opt_d) {
+        std::mt19937_64 rng(opt_seed);
+        int r = std::uniform_int_distribution<int>(1, std::max(n, 1))(rng);
+        int k = 0;
+
+        for (auto p = dd.begin(); p != dd.end(); ++p) {
+            Score s;
+            auto hint = makeHint(*p, s);
+
+            if (!opt_d || s == top) {
+                ++k;
+                if (opt_a) std::cout << "Quiz #" << k << ": " << s << "\n";
+
+                if (opt_a || k == r) {
+                    printHint(hint);
+                    if (!opt_a) break;
+                }
+            }
 
 #ifdef DEBUG
-        dd.printDebugInfo(std::cerr);
+            dd.printDebugInfo(std::cerr);
 #endif
+        }
+    }
+    else {
+        TdZddSampler sampler(dd, opt_seed);
+        Score s;
+        printHint(makeHint(sampler.sample(), s));
     }
 
     m0.end("finished");